@@ -46,6 +46,7 @@ WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
 // Include header file of genetic programming system.
 #include "gp.h" 
 #include "gpconfig.h"
+#include "gpprim.h"
 
 #include "ant.h" 
 
@@ -61,6 +62,7 @@ double lengthFactor=1/1000.0;
 GPVariables cfg;
 char *InfoFileName="data";
 int energy;
+int Interpreter=0;
 struct GPConfigVarInformation configArray[]=
 {
   {"PopulationSize", DATAINT, &cfg.PopulationSize},
@@ -79,101 +81,161 @@ struct GPConfigVarInformation configArray[]=
   {"ShrinkMutationProbability", DATADOUBLE, &cfg.ShrinkMutationProbability},
   {"AddBestToNewPopulation", DATAINT, &cfg.AddBestToNewPopulation},
   {"SteadyState", DATAINT, &cfg.SteadyState},
+  {"ArenaAllocation", DATAINT, &cfg.ArenaAllocation},
+  {"HashConsing", DATAINT, &cfg.HashConsing},
+  {"Recycling", DATAINT, &cfg.Recycling},
+  {"OutOfCore", DATAINT, &cfg.OutOfCore},
+  {"FitnessMemo", DATAINT, &cfg.FitnessMemo},
+  {"ResultCacheSize", DATAINT, &cfg.ResultCacheSize},
+  {"EvaluationThreads", DATAINT, &cfg.EvaluationThreads},
   {"InfoFileName", DATASTRING, &InfoFileName},
   {"LengthFactor", DATADOUBLE, &lengthFactor},
   {"Energy", DATAINT, &energy},
+  {"Interpreter", DATAINT, &Interpreter},
   {"", DATAINT, NULL}
 };
 
-// The ant on the trail
-Ant ant;
+// The trail as it is read from the file.  Each evaluation lets a
+// copy of it walk, so that GPs can be evaluated on several threads at
+// once (configuration parameter EvaluationThreads).
+Ant trail;
 
-// Used for printing the trail to a file during evaluation
-int printAnt=0;
-ofstream antFile;
+// The function and terminal set
+GPAdfNodeSet adfNs;
 
 
 
-// We have the freedom to define this function in any way we like.
-// This function evaluates the fitness of a genetic tree and is
-// recursive of course.
-int MyGene::evaluate ()
+// The functions and terminals.  The evaluation functions get the ant
+// as context.  The position in AntPrimitives gives the node values.
+struct Left : public GPPrimitiveT<0>
 {
-  int result, sum;
-  switch (node->value ())
-    {
+  // Turn left and return 0
+  static const char* name () { return "LEFT"; }
+  template <class Arguments>
+  static int evaluate (Arguments& a) { a.context.left (); return 0; }
+};
 
-    case LEFT: 
-      // Turn left and return 0
-      ant.left ();
-      return 0;
-      
-    case RIGHT:
-      // Turn right and return 0
-      ant.right ();
-      return 0;
-      
-    case FORWARD:
-      // Move forward
-      result=ant.forward ();
+struct Right : public GPPrimitiveT<0>
+{
+  // Turn right and return 0
+  static const char* name () { return "RIGHT"; }
+  template <class Arguments>
+  static int evaluate (Arguments& a) { a.context.right (); return 0; }
+};
 
-      // Print the ant?
-      if (printAnt)
-	antFile << ant << '\n' << '\n';
+struct Forward : public GPPrimitiveT<0>
+{
+  // Move forward and return whether there was food.  Print the ant?
+  static const char* name () { return "FORWARD"; }
+  template <class Arguments>
+  static int evaluate (Arguments& a) { 
+    int result=a.context.forward ();
+    if (a.context.trace)
+      *a.context.trace << a.context << '\n' << '\n';
+    return result; }
+};
 
-      // Return whether there was food
-      return result;
-      
-    case IFFOODAHEAD:
-      // If thereis a food in the direction you are facing evaluate
-      // the first branch otherwise evolve the second branch
-      if (ant.isFoodAhead ())    
-	return NthMyChild(0)->evaluate ();
-      else
-	return NthMyChild(1)->evaluate ();
-      
-    case PROG2:
-      // Evaluate both children
-      sum=NthMyChild(0)->evaluate ();
-      sum+=NthMyChild(1)->evaluate ();
-      return sum;
-      
-    case PROG3:
-      // Evaluate all three children
-      sum=NthMyChild(0)->evaluate ();
-      sum+=NthMyChild(1)->evaluate ();
-      sum+=NthMyChild(2)->evaluate ();
-      return sum;
-      
-    default: 
-      GPExitSystem ("MyGene::evaluate", "Undefined function value");
-    }
-  
-  // We should never reach this point
-  return 0;
+struct IfFoodAhead : public GPPrimitiveT<2>
+{
+  // If there is food in the direction the ant is facing evaluate the
+  // first argument, otherwise the second
+  static const char* name () { return "IFFOODAHEAD"; }
+  template <class Arguments>
+  static int evaluate (Arguments& a) { 
+    return a.context.isFoodAhead () ? a[0] : a[1]; }
+};
+
+struct Prog2 : public GPPrimitiveT<2>
+{
+  // Evaluate both arguments and return the sum
+  static const char* name () { return "PROG2"; }
+  template <class Arguments>
+  static int evaluate (Arguments& a) { 
+    int sum=a[0];
+    return sum+a[1]; }
+};
+
+struct Prog3 : public GPPrimitiveT<3>
+{
+  // Evaluate all three arguments and return the sum
+  static const char* name () { return "PROG3"; }
+  template <class Arguments>
+  static int evaluate (Arguments& a) { 
+    int sum=a[0];
+    sum+=a[1];
+    return sum+a[2]; }
+};
+
+typedef GPPrimitiveSetT<int, Ant, Left, Right, Forward, IfFoodAhead, 
+			Prog2, Prog3> AntPrimitives;
+
+
+
+// This function evaluates the fitness of a genetic tree.  It's
+// recursive of course, through the primitives.
+int MyGene::evaluate (Ant& ant)
+{
+  return AntPrimitives::evaluate (*this, ant);
 }
 
 
 
+// The primitives for the compiled evaluation (configuration
+// parameter Interpreter=1).  They do the same as MyGene::evaluate(),
+// and IFFOODAHEAD is a branch with the condition foodAhead.  The
+// context is the ant.
+static double primLeft (double*, void* ant) { 
+  ((Ant*) ant)->left (); return 0; }
+static double primRight (double*, void* ant) { 
+  ((Ant*) ant)->right (); return 0; }
+static double primForward (double*, void* context) 
+{ 
+  Ant& ant=*(Ant*) context;
+  int result=ant.forward ();
+  if (ant.trace)
+    *ant.trace << ant << '\n' << '\n';
+  return result;
+}
+static double foodAhead (double*, void* ant) { 
+  return ((Ant*) ant)->isFoodAhead (); }
+static double primProg2 (double* a, void*) { return a[0]+a[1]; }
+static double primProg3 (double* a, void*) { return a[0]+a[1]+a[2]; }
+
+
+
 // Evaluate the fitness of a GP and save it into the class variable
 // fitness.
 void MyGP::evaluate ()
+{
+  Ant ant=trail;
+  walk (ant);
+}
+
+
+
+// Let the ant walk along the trail, controlled by the GP, and save
+// the fitness.
+void MyGP::walk (Ant& ant)
 {
   // Prepare ant for moving
   ant.reset (energy);
 
   // Print the ant?
-  if (printAnt)
-    antFile << ant << '\n' << '\n';
+  if (ant.trace)
+    *ant.trace << ant << '\n' << '\n';
 
   // While the ant still has energy evaluate the GP accumulating the
   // fitness.  If, however, the whole trail is eaten, we can stop the
   // evaluation to speed things up, except we want to have a printout
-  // of the ant's movements.
+  // of the ant's movements.  The GP is either evaluated gene by gene
+  // or compiled and run by the kernel.
   int rawFitness=0;
   while ((ant.energy>0) && 
-	 ((rawFitness<ant.maxFood) || printAnt))
-    rawFitness+=NthMyGene (0)->evaluate ();
+	 ((rawFitness<ant.maxFood) || ant.trace))
+    if (Interpreter)
+      rawFitness+=(int) run (adfNs, &ant);
+    else
+      rawFitness+=NthMyGene (0)->evaluate (ant);
 
   // Save standardized fitness in object.  Add square times the tree
   // length multiplied with a factor, to go for small trees, and (most
@@ -192,18 +254,19 @@ void createNodeSet (GPAdfNodeSet& adfNs)
   
   // Now define the function and terminal set for each ADF and place
   // function/terminal sets into overall ADF container
-  GPNodeSet& ns=*new GPNodeSet (6);
+  GPNodeSet& ns=*new GPNodeSet (AntPrimitives::size);
   adfNs.put (0, ns);
   
-  // Define functions/terminals and place them into the appropriate
-  // sets. Terminals take two arguments, functions three (the third
-  // parameter is the number of arguments the function has)
-  ns.putNode (*new GPNode (LEFT, "LEFT"));
-  ns.putNode (*new GPNode (RIGHT, "RIGHT"));
-  ns.putNode (*new GPNode (FORWARD, "FORWARD"));
-  ns.putNode (*new GPNode (IFFOODAHEAD, "IFFOODAHEAD", 2));
-  ns.putNode (*new GPNode (PROG2, "PROG2", 2));
-  ns.putNode (*new GPNode (PROG3, "PROG3", 3));
+  // The functions and terminals are the ones of the primitive set
+  AntPrimitives::createNodes (ns);
+
+  // The primitives for the compiled evaluation
+  ns.setPrimitive (AntPrimitives::id<Left> (), primLeft);
+  ns.setPrimitive (AntPrimitives::id<Right> (), primRight);
+  ns.setPrimitive (AntPrimitives::id<Forward> (), primForward);
+  ns.setBranch (AntPrimitives::id<IfFoodAhead> (), foodAhead);
+  ns.setPrimitive (AntPrimitives::id<Prog2> (), primProg2);
+  ns.setPrimitive (AntPrimitives::id<Prog3> (), primProg3);
 }
 
 
@@ -245,13 +308,12 @@ int main ()
   cout << cfg << endl;
   
   // Create the adf function/terminal set and print it out.
-  GPAdfNodeSet adfNs;
   createNodeSet (adfNs);
   cout << adfNs << endl; 
   fout << adfNs << endl;  
   
   // Read the trail
-  ant.readTrail ("santafe.trl");
+  trail.readTrail ("santafe.trl");
 
   // Create a population with this configuration
   cout << "Creating initial population ..." << endl;
@@ -268,15 +330,27 @@ int main ()
     {
       // Create a new generation from the old one by applying the
       // genetic operators
-      if (!cfg.SteadyState)
+      if (!cfg.SteadyState && !newPop)
 	newPop=new MyPopulation (cfg, adfNs);
       pop->generate (*newPop);
       
-      // Delete the old generation and make the new the old one
+      // Delete the old generation and make the new the old one.  If
+      // Recycling is set, the old generation is only emptied and
+      // becomes the new population of the next generation.
       if (!cfg.SteadyState)
 	{
-	  delete pop;
+	  MyPopulation* oldPop=pop;
 	  pop=newPop;
+	  if (cfg.Recycling)
+	    {
+	      newPop=oldPop;
+	      newPop->clear ();
+	    }
+	  else
+	    {
+	      delete oldPop;
+	      newPop=NULL;
+	    }
 	}
 
       // Create a report of this generation and how well it is doing
@@ -284,9 +358,10 @@ int main ()
     }
   
   // Print trail while evaluating the best one of the last generation
-  printAnt=1;
-  antFile.open (strAntFile.str());
-  pop->NthMyGP(pop->bestOfPopulation)->evaluate();
+  ofstream antFile (strAntFile.str());
+  Ant ant=trail;
+  ant.trace=&antFile;
+  pop->NthMyGP(pop->bestOfPopulation)->walk (ant);
   antFile.close ();
 
   cout << "\nResults are in " 
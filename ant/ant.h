@@ -34,14 +34,6 @@ WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
 
 --------------------------------------------------------------- */
 
-// Identifiers for functions and terminals
-const int LEFT=0;        // Turn left
-const int RIGHT=1;       // Turn right
-const int FORWARD=2;     // Move forward
-const int IFFOODAHEAD=3; // If food is ahead
-const int PROG2=4;       // Execute two arguments, return sum
-const int PROG3=5;       // Execute three arguments, return sum
-
 // What character in the trail file means what?
 const char NOTHING='.';
 const char FOOD='X';
@@ -64,6 +56,8 @@ struct position {
 class Ant
 {
 public:
+  Ant () { trace=NULL; }
+
   void readTrail (char *fname);
 
   void reset (int energy_);
@@ -89,6 +83,10 @@ public:
 
   // The maximum amount of food (or fitness) that can be reached
   int maxFood;
+
+  // The stream the trail is printed to after every move (NULL for
+  // none)
+  ostream* trace;
 };
 
 
@@ -120,7 +118,7 @@ public:
   MyGene* NthMyChild (int n) {
     return (MyGene*) GPContainer::Nth (n); }
 
-  int evaluate ();
+  int evaluate (Ant& ant);
 };
 
 
@@ -146,6 +144,7 @@ public:
     return (MyGene*) GPContainer::Nth (n); }
 
   virtual void evaluate ();
+  void walk (Ant& ant);
 };
 
 
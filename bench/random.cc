@@ -0,0 +1,176 @@
+// random.cc
+
+/* -------------------------------------------------------------------
+
+Compares the speed of the random number generators of the kernel
+with that of the generator it used before (ran1 of Numerical
+Recipes), and shows the bias of the modulo operator.
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+
+#include "gp.h"
+
+using namespace std;
+
+// The number of random numbers each measurement draws, which can be
+// given on the command line
+long numDraws=10000000;
+
+// Keeps the compiler from optimising the loops away
+volatile long sink;
+
+
+
+// Prints the time per number since start
+void report (const char* what, double start)
+{
+  double ns=(GPTime ()-start)*1e9/numDraws;
+  cout << "  " << setw (40) << left << what << right 
+       << setw (8) << setprecision (3) << ns << " ns" << endl;
+}
+
+
+
+// Measures a generator: the raw numbers, numbers below n with the
+// modulo operator and with below(), and with indices() a tournament
+// at a time
+void measure (const char* name, GPRandomGenerator& g, int n)
+{
+  cout << name << ":" << endl;
+
+  double start=GPTime ();
+  unsigned long long x=0;
+  for (long i=0; i<numDraws; i++)
+    x^=g.next ();
+  sink=(long) x;
+  report ("next()", start);
+
+  start=GPTime ();
+  long sum=0;
+  for (long i=0; i<numDraws; i++)
+    sum+=(long) ((g.next ()>>33)%n);
+  sink=sum;
+  report ("(next()>>33)%n", start);
+
+  start=GPTime ();
+  sum=0;
+  for (long i=0; i<numDraws; i++)
+    sum+=g.below (n);
+  sink=sum;
+  report ("below(n)", start);
+
+  const int tournamentSize=7;
+  int tournament[tournamentSize];
+  start=GPTime ();
+  sum=0;
+  for (long i=0; i<numDraws; i+=tournamentSize)
+    {
+      g.indices (tournament, tournamentSize, 0, n);
+      sum+=tournament[0];
+    }
+  sink=sum;
+  report ("indices(), 7 at a time", start);
+}
+
+
+
+int main (int argc, char** argv)
+{
+  if (argc>1)
+    numDraws=atol (argv[1]);
+  const int n=500;
+
+  cout << numDraws << " numbers below " << n 
+       << ", time per number" << endl;
+
+  // The generator GPrand() used before, as it was called
+  GPLegacyGenerator legacy (1);
+  cout << "ran1 (before):" << endl;
+  double start=GPTime ();
+  long sum=0;
+  for (long i=0; i<numDraws; i++)
+    sum+=legacy.ran1 ()%n;
+  sink=sum;
+  report ("ran1()%n", start);
+
+  GPRandomStream stream (0, 0, 0, GPRandomProgram);
+  measure ("GPRandomStream", stream, n);
+  GPXoshiroGenerator xoshiro (1);
+  measure ("GPXoshiroGenerator", xoshiro, n);
+  measure ("GPLegacyGenerator", legacy, n);
+
+  // GPrand() and GPRandomBelow() as the kernel calls them, with the
+  // stream of the program
+  cout << "Kernel functions:" << endl;
+  start=GPTime ();
+  sum=0;
+  for (long i=0; i<numDraws; i++)
+    sum+=GPrand ()%n;
+  sink=sum;
+  report ("GPrand()%n", start);
+  start=GPTime ();
+  sum=0;
+  for (long i=0; i<numDraws; i++)
+    sum+=GPRandomBelow (n);
+  sink=sum;
+  report ("GPRandomBelow(n)", start);
+
+  // The modulo operator favours the small numbers if n doesn't divide
+  // the range of the generator.  With n=1.5e9 and numbers below 2^31,
+  // the lower half of the range comes up 65% of the time.
+  const long large=1500000000l;
+  long lowerMod=0, lowerBelow=0;
+  for (long i=0; i<numDraws; i++)
+    {
+      if (GPrand ()%large<large/2)
+	lowerMod++;
+      if (GPRandomBelow (large)<large/2)
+	lowerBelow++;
+    }
+  cout << "Numbers below 1.5e9 in the lower half of the range:" << endl
+       << "  GPrand()%n " << (double) lowerMod/numDraws 
+       << ", GPRandomBelow(n) " << (double) lowerBelow/numDraws << endl;
+
+  return 0;
+}
@@ -50,6 +50,7 @@ Fax:    (UK) 061 745 5999
 #define __GP_H
 
 #include <iostream>
+#include <stddef.h>
 
 using std::ostream;
 using std::istream;
@@ -69,15 +70,248 @@ void GPPrintCopyright (ostream& os);
 // debugging the code to find the location that caused the error
 #define GPCREATE_SEGMENTATIONFAULT_ON_ERROR 1
 
-// Random number functions for gp system
+// Containers with at most this many elements keep their pointer
+// array inside the container object itself instead of allocating it
+// separately.  Most genes have an arity of 3 or less, so child access
+// during evaluation stays within the cache line of the parent gene
+// and no extra allocation is made per gene.  Set to 0 to always
+// allocate the array separately.
+#define GPCONTAINERINLINESIZE 3
+
+// Share subtrees between genetic programs instead of copying them.
+// Copying a GP or a gene then copies only the object itself, and its
+// trees or children are referenced by both copies.  Crossover and
+// mutation copy the genes on the path to the gene they change, if
+// they are shared (copy on write).  This makes reproduction and
+// selection cheap and saves a lot of memory.  Genes must not be
+// changed in place unless GPGene::unsharePath() was called, and they
+// can't be allocated from an arena (GPVariables parameter
+// ArenaAllocation).
+#ifndef GPSHARESUBTREES
+#define GPSHARESUBTREES 0
+#endif
+
+// Genes refer to their node by a 16 bit index into a table of all
+// nodes instead of a pointer (see class GPNodeRef).  This makes genes
+// smaller, and they are saved and loaded with that index, so there is
+// no need to search the node set for the node value when a population
+// is loaded.  A saved population can be loaded only by a program that
+// creates its nodes in the same order as the one that saved it.
+#ifndef GPCOMPACTNODES
+#define GPCOMPACTNODES 0
+#endif
+
+// Compiled GPs (see GPCode) are interpreted with direct threading:
+// every instruction holds the address of the interpreter code that
+// executes it, and each one jumps straight to the next instead of
+// returning to a central switch statement.  This needs the label
+// addresses of GNU C++, other compilers use the switch.
+#ifndef GPTHREADEDCODE
+#ifdef __GNUC__
+#define GPTHREADEDCODE 1
+#else
+#define GPTHREADEDCODE 0
+#endif
+#endif
+
+// GPs can be evaluated on several threads at once (GPVariables
+// parameter EvaluationThreads, see GPThreadPool).  This needs POSIX
+// threads; without them, the thread pool runs everything on the
+// calling thread.  Data that belongs to the thread evaluating a GP
+// is declared GPThreadLocal.
+#ifndef GPTHREADS
+#define GPTHREADS 1
+#endif
+#if GPTHREADS
+#include <pthread.h>
+#define GPThreadLocal thread_local
+#else
+#define GPThreadLocal
+#endif
+
+// Random number functions for gp system.  The numbers come from the
+// generator selected on the calling thread (see GPRandomGenerator),
+// or from the stream of the program, if none is selected.  GPsrand()
+// sets the seed of all streams.  GPrand() returns a number in the
+// range 0..2^31-1, GPRandomBelow() one in the range 0..n-1 (without
+// the bias of GPrand()%n), GPRandomUniform() one in [0,1), and
+// GPRandomIndices() fills an array with num of them in the range
+// start..start+n-1 at once.
 void GPsrand (long);
 long GPrand ();
+long GPRandomBelow (long n);
+double GPRandomUniform ();
+void GPRandomIndices (int* indices, int num, int start, int n);
 int GPRandomPercent (double percent);
 
+// The number of choices between function and terminal creation draws
+// at once (see GPGene::create())
+const int GPCreationBatchSize=8;
+
+// A generator of random numbers: next() returns 64 random bits, the
+// other functions are built on it.  below() maps 32 of them to the
+// range 0..n-1 by a multiplication, and draws again in the rare case
+// that the result would be biased (Lemire's method); indices() uses
+// both halves of each number.  A generator is plugged in by selecting
+// it on a thread; the population selects the ones it creates with
+// GPPopulation::createRandomStream().
+class GPRandomGenerator
+{
+public:
+  virtual ~GPRandomGenerator () {}
+  virtual unsigned long long next ()=0;
+
+  long below (long n);
+  double uniform () { 
+    return (double) (next ()>>11)*(1.0/9007199254740992.0); }
+  void indices (int* indices, int num, int start, int n);
+
+  // Selects a generator on the calling thread (NULL for the stream
+  // of the program) and returns the one that was selected before
+  static GPRandomGenerator* select (GPRandomGenerator* generator) {
+    GPRandomGenerator* previous=current; current=generator; 
+    return previous; }
+  static GPRandomGenerator* selected () { return current; }
+
+private:
+  static GPThreadLocal GPRandomGenerator* current;
+};
+
+// A stream of random numbers.  The n-th number of a stream is a hash
+// (that of SplitMix64) of its key and n, so a stream is nothing but a
+// key and a counter: streams don't depend on each other, and a stream
+// can skip any number of numbers at once.  The key is made from the
+// seed and from what the stream is used for: the generation, the deme
+// and the number of the individual in its deme, and the use.  The
+// population selects the stream of each individual it creates,
+// breeds or evaluates, so a seeded run gives the same results no
+// matter how many threads evaluate the GPs, or in which order.  The
+// stream of the program (generation -1) is used outside of that, and
+// must be used by the main thread only; other threads select a
+// stream of their own.
+enum GPRandomUse { GPRandomProgram, GPRandomCreation, GPRandomBreeding, 
+		   GPRandomMigration, GPRandomEvaluation };
+
+class GPRandomStream : public GPRandomGenerator
+{
+public:
+  GPRandomStream () { key=0; counter=0; }
+  GPRandomStream (int generation, int deme, int individual, 
+		  GPRandomUse use);
+
+  virtual unsigned long long next () {
+    unsigned long long z=key+(++counter)*0x9e3779b97f4a7c15ULL;
+    z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+    z=(z^(z>>27))*0x94d049bb133111ebULL;
+    return z^(z>>31); }
+  void skip (unsigned long long n) { counter+=n; }
+
+private:
+  unsigned long long key, counter;
+};
+
+// The generator xoshiro256** of Blackman and Vigna: 256 bits of
+// state, seeded from a 64 bit number.  jump() advances it by 2^128
+// numbers, which gives sequences that don't overlap.  A population
+// that wants it for its streams seeds it with the first number of
+// the stream it replaces, which keeps the runs reproducible.
+class GPXoshiroGenerator : public GPRandomGenerator
+{
+public:
+  GPXoshiroGenerator (unsigned long long seed);
+
+  virtual unsigned long long next () {
+    unsigned long long result=rotate (s[1]*5, 7)*9;
+    unsigned long long t=s[1]<<17;
+    s[2]^=s[0]; s[3]^=s[1]; s[1]^=s[2]; s[0]^=s[3];
+    s[2]^=t; s[3]=rotate (s[3], 45);
+    return result; }
+  void jump ();
+
+private:
+  static unsigned long long rotate (unsigned long long x, int k) {
+    return (x<<k) | (x>>(64-k)); }
+  unsigned long long s[4];
+};
+
+// The generator ran1 of ``Numerical Recipes in C'', which GPrand()
+// used before the streams.  A number is put together from three of
+// its numbers of 31 bits; ran1() returns one of them.  Kept for
+// comparisons (see bench/random.cc).
+class GPLegacyGenerator : public GPRandomGenerator
+{
+public:
+  GPLegacyGenerator (long seed);
+
+  virtual unsigned long long next () {
+    unsigned long long x=(unsigned long long) ran1 ();
+    x=(x<<31) ^ (unsigned long long) ran1 ();
+    return (x<<31) ^ (unsigned long long) ran1 (); }
+  long ran1 ();
+
+private:
+  enum { tableSize=32 };
+  long idum, iy, iv[tableSize];
+};
+
+// Wall clock time in seconds, for measuring the evaluation
+double GPTime ();
+
 // Init and exit
 void GPInit (int printCopyright, long seedRandomGenerator);
 void GPExitSystem (char *functionName, char *errorMessage); 
 
+// Memory management.  All kernel objects and the arrays of the
+// containers are allocated and freed by these functions.  If an
+// arena is selected (see class GPArena), memory is taken from the
+// arena, otherwise from the heap.
+void* GPAllocate (size_t size);
+void GPFree (void* p);
+
+// An arena hands out memory from big slabs by simply incrementing a
+// pointer.  Freeing a block that was allocated from an arena does
+// nothing at all; the memory is given back as a whole when the arena
+// is deleted.  GPPopulation uses an arena for each generation, if
+// the GPVariables parameter ArenaAllocation is set, so that dropping
+// a generation doesn't mean to delete every single gene.  If the
+// GPVariables parameter Recycling is set as well, the arena is only
+// reset and its slabs are used again for the next generation.
+class GPArena
+{
+public:
+  GPArena (size_t slabSize_=1048576);
+  ~GPArena ();
+
+  void* allocate (size_t size);
+  void reset ();
+  long bytesAllocated () { return allocated; }
+
+  // Select the arena GPAllocate() takes memory from (NULL means the
+  // heap).  Returns the arena that was selected before.
+  static GPArena* select (GPArena* arena);
+  static GPArena* selected () { return current; }
+
+  // Returns the arena a block was allocated from (NULL, if it was
+  // allocated from the heap)
+  static GPArena* owner (void* p);
+
+private:
+  // The slabs are linked together to be able to delete them
+  struct Slab
+  {
+    Slab* next;
+  };
+  Slab* slabs;
+  Slab* spareSlabs;
+  Slab* largeSlabs;
+  char* freePtr;
+  size_t freeSize;
+  size_t slabSize;
+  long allocated;
+
+  static GPArena* current;
+};
+
 // Registering for load/save
 class GPObject;
 GPObject* GPCreateRegisteredClassObject (int ID);
@@ -95,6 +329,7 @@ void GPRegisterKernelClasses ();
 #define GPGeneID         7
 #define GPID             8
 #define GPPopulationID   9
+#define GPFlatID        10
 #define GPUserID        50
 
 
@@ -113,6 +348,11 @@ public:
   virtual ~GPObject () {}
 
   GPObject (const GPObject&) {}
+
+  // Memory for all kernel objects comes from GPAllocate()
+  static void* operator new (size_t size) { return GPAllocate (size); }
+  static void operator delete (void* p) { GPFree (p); }
+
   // Duplicate object. This function must be provided by every
   // inheriting class!!!
   virtual GPObject& duplicate ()=0;
@@ -151,7 +391,14 @@ public:
 
   int containerSize() const { return contSize; }
 
-  GPObject* Nth (int n) const;
+  GPObject* Nth (int n) const {
+#if GPINTERNALCHECK
+    if (!container)
+      GPExitSystem ("GPContainer::Nth", "No container");
+    if (n>=contSize || n<0)
+      GPExitSystem ("GPContainer::Nth", "Wrong range for index n");
+#endif
+    return container[n]; }
   GPObject** getPointerAddress (int n) const;
   void put (int n, GPObject& gpo);
   GPObject& get (int n);
@@ -172,6 +419,11 @@ protected:
   GPObject** container;
   // The container size
   int contSize;
+#if GPCONTAINERINLINESIZE>0
+  // Storage used for container if it has no more than
+  // GPCONTAINERINLINESIZE elements (container then points here)
+  GPObject* inlineContainer[GPCONTAINERINLINESIZE];
+#endif
 };
 
 
@@ -183,10 +435,12 @@ protected:
 class GPNode : public GPObject
 {
 public:
-  GPNode () { nodeValue=0; numOfArgs=0; representation=0; }
+  GPNode () { nodeValue=0; numOfArgs=0; representation=0; 
+    shareCount=0; registerNode (); }
   GPNode (int nVal, char* str, int args=0) : nodeValue(nVal), 
-      numOfArgs(args) { representation=copyString (str); }
-  virtual ~GPNode () { delete [] representation; }
+      numOfArgs(args) { representation=internString (str); 
+    shareCount=0; registerNode (); }
+  virtual ~GPNode () { unregisterNode (); }
 
   GPNode (const GPNode& gpo);
   virtual GPObject& duplicate () { return *(new GPNode(*this)); }
@@ -198,6 +452,24 @@ public:
   int isTerminal () { return numOfArgs==0; }
   int arguments () { return numOfArgs; }
 
+  // Reference counting, see GPNodeSet
+  GPNode* share () { shareCount++; return this; }
+  static void release (GPNode* n) { 
+    if (n->shareCount) n->shareCount--; else delete n; }
+
+  // Returns the copy of the string in the table of all node strings.
+  // Equal strings are stored only once and never deleted.
+  static char* internString (char* s);
+
+#if GPCOMPACTNODES
+  // The index of the node in the table of all nodes, the node with a
+  // given index (NULL if there is none; the index is not checked, it
+  // must be less than tableSize()) and the size of the table
+  int tableIndex () { return nodeIndex; }
+  static GPNode* NthTableNode (int ix) { return nodeTable[ix]; }
+  static int tableSize () { return nodeTableSize; }
+#endif
+
   virtual int isA () { return GPNodeID; }
   virtual char* load (istream& is);
   virtual void save (ostream& os);
@@ -209,34 +481,124 @@ public:
 
 protected:
   // The nodes numerical value, the number of arguments it takes (0 if
-  // it is a terminal) and its string representation.  We operate on a
-  // duplicate
+  // it is a terminal) and its string representation.  The string is
+  // interned (see internString()), so copies of the node refer to the
+  // same string
   int nodeValue;
   int numOfArgs;
   char* representation;
 
-  char *copyString (char *s);
+  // The number of node sets that share this node apart from the one
+  // that owns it
+  int shareCount;
+
+#if GPCOMPACTNODES
+  // Every node enters itself into the table of all nodes when it is
+  // created.  Index 0 is never used, it stands for no node.
+  void registerNode ();
+  void unregisterNode () { nodeTable[nodeIndex]=NULL; }
+  unsigned short nodeIndex;
+  static GPNode** nodeTable;
+  static int nodeTableSize;
+#else
+  void registerNode () {}
+  void unregisterNode () {}
+#endif
+};
+
+
+
+#if GPCOMPACTNODES
+// A reference to a node by its index in the table of all nodes.  It
+// behaves like a pointer to the node (GPGene::node is of this type if
+// GPCOMPACTNODES is set), but needs only two bytes.  The index is a
+// dense small integer and can be used by the evaluation for dispatch.
+class GPNodeRef
+{
+public:
+  GPNodeRef () { ix=0; }
+  GPNodeRef (GPNode* n) { ix=n ? n->tableIndex () : 0; }
+
+  GPNode* operator-> () const { return GPNode::NthTableNode (ix); }
+  GPNode& operator* () const { return *GPNode::NthTableNode (ix); }
+  operator GPNode* () const { return GPNode::NthTableNode (ix); }
+  int operator == (const GPNodeRef& n) const { return ix==n.ix; }
+  int operator != (const GPNodeRef& n) const { return ix!=n.ix; }
+
+  int index () const { return ix; }
+  void setIndex (int i) { ix=(unsigned short) i; }
+
+private:
+  unsigned short ix;
 };
+#endif
+
 
 
+// A primitive of the compiled evaluation: it gets the values of the
+// arguments of the node and the context the user handed to
+// GPCode::run()
+typedef double (*GPPrimitive) (double* args, void* context);
 
+// One instruction of a compiled GP.  The instructions are the
+// primitives of the nodes in postfix order, so each instruction
+// takes its arguments from the top of the stack and leaves its result
+// there.  A gene call is a primitive that gets its gene instead of
+// the context.  A branch evaluates the function (without arguments)
+// and continues with the first argument of the node, if the result
+// isn't 0, and with the second otherwise: it is compiled into jumps
+// and only one of the two arguments is evaluated.  Jumps and returns
+// are generated by GPCode itself.
+enum GPOpcode { GPNoPrimitive, GPPrimitiveCall, GPAdfCall, GPArgument,
+		GPGeneCall, GPBranch, GPJump, GPReturn };
+
+struct GPInstruction
+{
+  const void* handler;
+  GPPrimitive function;
+  union {
+    int operand;
+    void* data;
+  };
+  short opcode;
+  short arity;
+};
+
+
+
+// Node sets are built once by the user and not changed afterwards.
+// Copies of a node set (and of a GPAdfNodeSet) don't copy the nodes
+// (or node sets), but share them; share() and release() count the
+// references.  A node set that is shared must not be changed any
+// more: putNode(), put() and load() stop with an error then.  As
+// nothing is written to a shared node set, populations and threads
+// can read it at the same time.  A GPPopulation shares its
+// GPAdfNodeSet as long as it exists.  The reference counting itself
+// is not thread-safe, so copies are made and deleted by one thread.
 class GPNodeSet : public GPContainer
 {
 public:
-  GPNodeSet () { numFunctions=0; numTerminals=0; }
+  GPNodeSet () { numFunctions=0; numTerminals=0; shareCount=0; 
+    primitive=NULL; source=NULL; pure=0; }
   GPNodeSet (int numOfNodes) : GPContainer (numOfNodes) {
-    numFunctions=0; numTerminals=0; }
+    numFunctions=0; numTerminals=0; shareCount=0; primitive=NULL; 
+    source=NULL; pure=0; }
 
-  GPNodeSet (const GPNodeSet& gpo) : GPContainer(gpo) { 
-    numFunctions=gpo.numFunctions; numTerminals=gpo.numTerminals; }
+  GPNodeSet (const GPNodeSet& gpo);
+  virtual ~GPNodeSet ();
   virtual GPObject& duplicate () { return *(new GPNodeSet(*this)); }
 
+  GPNodeSet* share () { shareCount++; return this; }
+  static void release (GPNodeSet* ns) { 
+    if (ns->shareCount) ns->shareCount--; else delete ns; }
+
   virtual void put (int, GPObject&);
   virtual void putNode (GPNode& gpo);
 
   virtual void printOn (ostream& os);
 
   virtual GPNode* searchForNode (int value);
+  int indexOfNode (GPNode* gpo);
   GPNode* NthNode (int n) {
     return (GPNode*) GPContainer::Nth (n); }
 
@@ -244,6 +606,36 @@ public:
   virtual GPNode& chooseTerminal();
   virtual GPNode* chooseNodeWithArgs (int args);
 
+  // Primitives for the compiled evaluation of GPs (see GPCode): The
+  // node with the given value is a call of function f, a call of the
+  // tree (ADF) with the given number, or the argument with the given
+  // number of the ADF the node set belongs to.  A gene primitive is
+  // handed the gene instead of the context (for values that belong
+  // to the gene, like random constants), and a branch node chooses
+  // one of its two arguments by the value of function condition.
+  void setPrimitive (int value, GPPrimitive f);
+  void setAdfCall (int value, int tree);
+  void setArgument (int value, int argNumber);
+  void setGenePrimitive (int value, GPPrimitive f);
+  void setBranch (int value, GPPrimitive condition);
+  GPInstruction* NthPrimitive (int n) { 
+    return primitive ? primitive+n : NULL; }
+
+  // The C++ source of a node for native code (see GPNativeCompiler):
+  // an expression, in which %1 to %9 stand for the arguments of the
+  // node and %% for the character %.  ADF calls and arguments are
+  // taken from the primitives.
+  void setSource (int value, char* src);
+  char* NthSource (int n) { return source ? source[n] : NULL; }
+
+  // A node set is pure, if the results of all its nodes depend on
+  // nothing but their arguments and the context: they have no side
+  // effects and give the same result every time.  The subtrees of
+  // pure node sets can be evaluated for many contexts at once and
+  // their results kept (see GP::runCases() and GPResultCache).
+  void setPure (int pure_=1);
+  int isPure () { return pure; }
+
   virtual int isA () { return GPNodeSetID; }
   virtual char* load (istream& is);
   virtual void save (ostream& os);
@@ -257,6 +649,20 @@ protected:
   // Container contains functions from 0..numFunctions-1 and terminals
   // from containerSize()-1-numTerminals..containerSize()-1
   int numFunctions, numTerminals;
+
+  // The number of references to this node set apart from the owner's
+  int shareCount;
+
+  // The primitives of the nodes, same index as the container (NULL
+  // if none is set)
+  GPInstruction* primitive;
+  GPInstruction& newPrimitive (int value);
+
+  // Whether the node set was declared pure
+  int pure;
+
+  // The sources of the nodes (NULL if none is set)
+  char** source;
 };
 
 
@@ -264,29 +670,120 @@ protected:
 class GPAdfNodeSet : public GPContainer
 {
 public:
-  GPAdfNodeSet () {}
-  GPAdfNodeSet (int numOfTrees) : GPContainer(numOfTrees) {}
+  GPAdfNodeSet () { shareCount=0; }
+  GPAdfNodeSet (int numOfTrees) : GPContainer(numOfTrees) { 
+    shareCount=0; }
 
-  GPAdfNodeSet (const GPAdfNodeSet& gpo) : GPContainer(gpo) {}
+  GPAdfNodeSet (const GPAdfNodeSet& gpo);
+  virtual ~GPAdfNodeSet ();
   virtual GPObject& duplicate () { return *(new GPAdfNodeSet(*this)); }
 
+  GPAdfNodeSet* share () { shareCount++; return this; }
+  static void release (GPAdfNodeSet* adfNs) { 
+    if (adfNs->shareCount) adfNs->shareCount--; else delete adfNs; }
+  void put (int n, GPObject& gpo);
+
   // As we have no variables, we leave load and save to our container
   // class
   virtual int isA () { return GPAdfNodeSetID; }
+  virtual char* load (istream& is);
   virtual GPObject* createObject() { return new GPAdfNodeSet; }
 
   virtual void printOn (ostream& os);
 
   GPNodeSet* NthNodeSet (int n) { 
     return (GPNodeSet*) GPContainer::Nth (n); }
+  int isPure ();
 
   GPAdfNodeSet& operator = (GPAdfNodeSet& gpo) {
     GPExitSystem ("operator =", "Assignment operator not yet implemented"); 
     return gpo; }
+
+protected:
+  // The number of references to this set apart from the owner's
+  int shareCount;
+};
+
+
+
+// The compiled form of a GP: the trees as linear sequences of
+// instructions, interpreted by a loop with an explicit stack instead
+// of recursive calls of the genes.  run() evaluates a tree with the
+// given arguments (used by GPArgument instructions, may be NULL for
+// the main tree); context is handed on to the primitives.  The code
+// is created with GP::compile() and stays valid as long as the GP
+// isn't changed.  Nodes are emitted in postfix order, except for
+// branches: startBranch() is called before the first argument,
+// elseBranch() before the second and endBranch() after it.  Gene
+// primitives get the data given to emit().
+class GPCode
+{
+public:
+  GPCode (int trees, int size);
+  ~GPCode ();
+
+  void startTree (int tree);
+  void emit (GPNodeSet& ns, int nodeIndex, void* data=NULL);
+  int startBranch (GPNodeSet& ns, int nodeIndex);
+  int elseBranch (int branch);
+  void endBranch (int jump);
+  void endTree ();
+
+  double run (int tree, double* args, void* context);
+
+private:
+  GPInstruction& append ();
+
+  GPInstruction* code;
+  int codeSize, length;
+  int numTrees;
+  int* treeStart;
+  int* maxStack;
+  int stackDepth, currentTree;
+
+  // Whether the handlers of the instructions are set (GPTHREADEDCODE)
+  int threaded;
 };
 
 
 
+// The key of a subtree for GPResultCache, or of a whole GP for
+// GPFitnessTable: two independent hash values of its structure (the
+// nodes, as GPGene::compare() sees them), the number of nodes, and
+// flags telling what else the result of a subtree depends on (or
+// that it contains nodes of node sets that are not pure).  Only
+// subtrees without flags can be cached.  The hash values are mixed
+// with GPMixHash() (the finalizer of MurmurHash3).
+enum { GPResultDependsOnArguments=1, GPResultDependsOnGene=2, 
+       GPResultImpure=4 };
+
+struct GPResultKey
+{
+  unsigned long hash, check;
+  int length;
+  int flags;
+};
+
+inline unsigned long GPMixHash (unsigned long h)
+{
+  h^=h >> 33;
+  h*=0xff51afd7ed558ccdUL;
+  h^=h >> 33;
+  h*=0xc4ceb9fe1a85ec53UL;
+  h^=h >> 33;
+  return h;
+}
+
+// Adds the key of a part (e.g. a child) to a key
+inline void GPAddKey (GPResultKey& key, GPResultKey& part)
+{
+  key.hash=GPMixHash (key.hash*31+part.hash);
+  key.check=GPMixHash (key.check ^ (part.check+(key.check << 6)
+				     +(key.check >> 2)));
+}
+
+
+
 // ------------------------------------------------------------------
 
 
@@ -294,6 +791,9 @@ public:
 // Prototypes
 class GP;
 class GPPopulation;
+class GPGeneTable;
+class GPDemeStore;
+class GPFitnessTable;
 
 // These definitions are for the different types of creation method
 // available to the genetic programming system and are set by the user.
@@ -340,7 +840,14 @@ public:
     DemeticGrouping,
     DemeSize,
     AddBestToNewPopulation,
-    SteadyState;
+    SteadyState,
+    ArenaAllocation,
+    HashConsing,
+    Recycling,
+    OutOfCore,
+    FitnessMemo,
+    ResultCacheSize,
+    EvaluationThreads;
   double CrossoverProbability, CreationProbability,
     SwapMutationProbability, ShrinkMutationProbability,
     DemeticMigProbability;
@@ -358,14 +865,24 @@ public:
 class GPGene : public GPContainer
 {
 public:
-  GPGene () { node=0; }
+  GPGene () { node=0; subtreeLength=0; subtreeDepth=0; shareCount=0; }
   GPGene (GPNode& gpo)
-    : node(&gpo), GPContainer(gpo.arguments()) {}
+    : node(&gpo), GPContainer(gpo.arguments()) {
+    subtreeLength=0; subtreeDepth=0; shareCount=0; }
+  virtual ~GPGene ();
 
-  GPGene (const GPGene& gpo)
-    : GPContainer (gpo) { node=gpo.node; }
+  GPGene (const GPGene& gpo);
   virtual GPObject& duplicate () { return *(new GPGene(*this)); }
 
+  // Take another reference to a gene or give one back (the gene is
+  // deleted if it was the last one).  Only used if GPSHARESUBTREES
+  // is set
+  GPGene* share () { shareCount++; return this; }
+  static void release (GPGene* g) { 
+    if (g->shareCount) g->shareCount--; else delete g; }
+  static GPGene** unsharePath (GPGene** rootPtr, int nodeNumber,
+			       int includeGene);
+
   virtual GPGene* createChild (GPNode& gpo) {
     return new GPGene (gpo); }
 
@@ -384,23 +901,26 @@ public:
   GPGene* NthChild (int n) {
     return (GPGene*) GPContainer::Nth (n); }
   GPGene** findNthNode (GPGene** rootPtr, int findFunction,
-			int &iLengthCount);
+			int &iLengthCount, int* nodeNumber=NULL);
 
-  virtual GPGene** choose (GPGene** rootPtr);
+  virtual GPGene** choose (GPGene** rootPtr, int* nodeNumber=NULL);
 
   int countFunctions ();
-  GPGene** chooseFunctionNode (GPGene** rootPtr);
+  GPGene** chooseFunctionNode (GPGene** rootPtr, int* nodeNumber=NULL);
 
   virtual int length ();
   virtual int depth (int depthSoFar=1);
+  void updatePath (int nodeNumber);
 
   virtual void create (enum GPCreationType ctype, int allowabledepth, 
 		       GPNodeSet& ns);
 
   friend int operator == (GPGene& pg1, GPGene& pg2);
   virtual int compare (GPGene& g);
+  virtual GPResultKey structureKey ();
 
   friend GP;
+  friend GPGeneTable;
 
   GPGene& operator = (GPGene& gpo) {
     GPExitSystem ("operator =", "Assignment operator not yet implemented"); 
@@ -412,12 +932,29 @@ protected:
   // pointers to the functions.  You can get all the information you
   // need from them... On the other hand, if we load a gene, we
   // load/save only the node value.  Another function has to be called
-  // after the load process to convert this value back to a pointer
+  // after the load process to convert this value back to a pointer.
+  // If GPCOMPACTNODES is set, the node is referenced by its index,
+  // which is loaded and saved directly.
+#if GPCOMPACTNODES
+  GPNodeRef node;
+#else
   union
   {
     GPNode* node;
     int nodeValue;
   };
+#endif
+
+  // Length and depth of the subtree starting at this gene, or 0 if
+  // not yet calculated.  The values are calculated on demand by
+  // length() and depth().  The kernel operators keep them up to date
+  // by calling updatePath() for the genes from the root to a changed
+  // gene.  If you change the structure of a tree yourself, you have
+  // to do the same.
+  int subtreeLength, subtreeDepth;
+
+  // Number of references to this gene besides the first one
+  int shareCount;
 };
 
 
@@ -425,13 +962,14 @@ protected:
 class GP : public GPContainer
 {
 public:
-  GP () { fitnessValid=0; GPlength=0; GPdepth=0; }
+  GP () { fitnessValid=0; GPlength=0; GPdepth=0; code=NULL; 
+    timePerNode=0.0; }
   GP (int trees) : GPContainer (trees) { fitnessValid=0; 
-    GPlength=0; GPdepth=0; }
+    GPlength=0; GPdepth=0; code=NULL; timePerNode=0.0; }
+
+  virtual ~GP ();
 
-  GP (const GP& gpo) : GPContainer(gpo) { stdFitness=gpo.stdFitness; 
-    fitnessValid=gpo.fitnessValid; GPlength=gpo.GPlength; 
-    GPdepth=gpo.GPdepth; }
+  GP (const GP& gpo);
   virtual GPObject& duplicate () { return *(new GP(*this)); }
 
   virtual GPGene* createGene (GPNode& gpo) {
@@ -442,29 +980,58 @@ public:
   GPGene* NthGene (int n) { return (GPGene*) GPContainer::Nth(n); }
 
   double getFitness () { return stdFitness; }
+  int isFitnessValid () { return fitnessValid; }
   virtual int length () { return GPlength; }
   virtual int depth () { return GPdepth; }
   virtual void calcLength ();
   virtual void calcDepth ();
 
+  // GPs that are the same for compare() must have the same
+  // structureKey() (see GPFitnessTable).  Both only look at the nodes
+  // of the trees, so a gene class that carries a value (e.g. a random
+  // constant) has to override GPGene::compare() and
+  // GPGene::structureKey() to take it into account.
   virtual int compare (GP& gp);
+  virtual GPResultKey structureKey ();
   virtual void create (enum GPCreationType ctype, int allowabledepth, 
 		       GPAdfNodeSet& adfNs);
 
-  void shrinkMutation ();
-  void swapMutation (GPAdfNodeSet& adfNs);
+  // The mutations return whether they changed the GP
+  virtual int shrinkMutation ();
+  virtual int swapMutation (GPAdfNodeSet& adfNs);
   virtual void mutate (GPVariables& GPVar, GPAdfNodeSet& adfNs);
   virtual GPContainer& cross (GPContainer* parents, 
 			      int maxdepthforcrossover);
   virtual void evaluate ();
 
+  // The compiled trees (see GPCode).  The code is created on the
+  // first call and kept until the GP is changed, which must be
+  // announced by invalidateFitness().
+  GPCode& compile (GPAdfNodeSet& adfNs) { 
+    if (!code)
+      code=createCode (adfNs);
+    return *code; }
+  double run (GPAdfNodeSet& adfNs, void* context) { 
+    return compile (adfNs).run (0, NULL, context); }
+  void runCases (GPAdfNodeSet& adfNs, int numCases, char* contexts, 
+		 int contextSize, double* results);
+  void invalidateFitness () { fitnessValid=0; releaseCode (); }
+  void releaseCode () { if (code) { delete code; code=NULL; } }
+
   virtual int isA () { return GPID; }
   virtual char* load (istream& is);
   virtual void save (ostream& os);
-  void resolveNodeValues (GPAdfNodeSet& adfNs);
+  virtual void resolveNodeValues (GPAdfNodeSet& adfNs);
   virtual GPObject* createObject() { return new GP; }
 
+  // Compact binary form used by GPDemeStore: the node indices of the
+  // trees in prefix order.  unpack() rebuilds the trees of a GP that
+  // was created with the correct number of trees.
+  virtual void pack (GPDemeStore& store, GPAdfNodeSet& adfNs);
+  virtual void unpack (char*& data, GPAdfNodeSet& adfNs);
+
   friend GPPopulation;
+  friend class GPEvaluationTask;
 
   GP& operator = (GP& gpo) {
     GPExitSystem ("operator =", "Assignment operator not yet implemented"); 
@@ -481,6 +1048,512 @@ protected:
 
   // Length and depth of GP
   int GPlength, GPdepth;
+
+  // The time the evaluation took per node, measured when the GP (or
+  // the one it was copied from) was evaluated on a thread pool (0 if
+  // it wasn't).  Offspring keep the time of their parent, so it is
+  // a guess of what their evaluation costs.
+  double timePerNode;
+
+  // The compiled trees, if any
+  GPCode* code;
+  virtual GPCode* createCode (GPAdfNodeSet& adfNs);
+};
+
+
+
+// A node of a tree stored in prefix order.  Instead of a pointer to
+// the node, the index of the node within the node set of the tree is
+// kept.  The number of arguments and the length of the subtree that
+// starts with this node (the node itself included) are stored as
+// well, so the children of a node can be found without any search:
+// the first child follows the node immediately, and the next sibling
+// of a node starts subtreeLength records later.
+struct GPFlatNode
+{
+  unsigned short nodeIndex;
+  unsigned short args;
+  int subtreeLength;
+};
+
+
+
+// A tree in prefix notation: one contiguous array of nodes
+struct GPFlatTree
+{
+  GPFlatNode* nodes;
+  int length;
+};
+
+
+
+// An alternative representation of a genetic program.  Each tree is
+// stored as one array in prefix order rather than as a pointer-linked
+// graph of genes.  Duplication is a copy of a few arrays, and walking
+// a tree touches consecutive memory only.  The class behaves like
+// class GP as far as the population is concerned, so the user simply
+// inherits from this class rather than GP and returns objects of it
+// in GPPopulation::createGP().  As there are no genes, the user
+// evaluates the trees by walking the arrays, for example
+//
+//   double MyGP::eval (int& ix)
+//   {
+//     switch (NthTreeNode (0, ix++).value ())
+//       {
+//       case '+': return eval (ix) + eval (ix);
+//       ...
+//
+// The container of the base class is not used.
+class GPFlat : public GP
+{
+public:
+  GPFlat ();
+  GPFlat (int trees);
+  virtual ~GPFlat ();
+
+  GPFlat (const GPFlat& gpo);
+  virtual GPObject& duplicate () { return *(new GPFlat(*this)); }
+
+  virtual void printOn (ostream& os);
+
+  int trees () { return numTrees; }
+  GPFlatNode* NthTree (int n) { return tree[n].nodes; }
+  int NthTreeLength (int n) { return tree[n].length; }
+  GPNode& NthTreeNode (int n, int ix) { 
+    return *adfNs->NthNodeSet (n)->NthNode (tree[n].nodes[ix].nodeIndex); }
+
+  virtual void calcLength ();
+  virtual void calcDepth ();
+
+  virtual int compare (GP& gp);
+  virtual GPResultKey structureKey ();
+  virtual void create (enum GPCreationType ctype, int allowabledepth, 
+		       GPAdfNodeSet& adfNs_);
+
+  virtual int shrinkMutation ();
+  virtual int swapMutation (GPAdfNodeSet& adfNs_);
+  virtual GPContainer& cross (GPContainer* parents, 
+			      int maxdepthforcrossover);
+
+  virtual int isA () { return GPFlatID; }
+  virtual char* load (istream& is);
+  virtual void save (ostream& os);
+  virtual void resolveNodeValues (GPAdfNodeSet& adfNs_);
+  virtual GPObject* createObject() { return new GPFlat; }
+
+  virtual void pack (GPDemeStore& store, GPAdfNodeSet& adfNs_);
+  virtual void unpack (char*& data, GPAdfNodeSet& adfNs_);
+
+  GPFlat& operator = (GPFlat& gpo) {
+    GPExitSystem ("operator =", "Assignment operator not yet implemented"); 
+    return gpo; }
+
+protected:
+  int choose (int n);
+  void printTree (ostream& os, int n, int ix);
+  void deleteTrees ();
+  virtual GPCode* createCode (GPAdfNodeSet& adfNs_);
+
+  // The node sets the node indices refer to.  Set by create() or
+  // resolveNodeValues()
+  GPAdfNodeSet* adfNs;
+
+  // The trees (main program and ADFs)
+  int numTrees;
+  GPFlatTree* tree;
+};
+
+
+
+// A table of the genes of a population for hash consing (GPVariables
+// parameter HashConsing, needs GPSHARESUBTREES): Structurally
+// identical subtrees (same node and the same children, see
+// GPGene::compare()) are stored only once and referenced by all GPs
+// that contain them, so that the trees of a population form a
+// directed acyclic graph.  As the children of a gene in the table are
+// themselves in the table, two genes are identical if they have the
+// same node and point to the same children.  The table takes a
+// reference to each gene, so that the genes are always shared and
+// never changed in place by crossover and mutation, which copy the
+// genes they change instead.  The copies are put into the table with
+// insert() again.  Genes must not have values apart from their node,
+// otherwise genes with different values would be merged.
+class GPGeneTable
+{
+public:
+  GPGeneTable ();
+  ~GPGeneTable ();
+
+  GPGene* canonical (GPGene* g);
+  void insert (GP& gp);
+  void purge ();
+  long size () { return numEntries; }
+
+private:
+  struct Entry
+  {
+    GPGene* gene;
+    Entry* next;
+  };
+
+  static unsigned long hash (GPGene* g);
+  static int sameGene (GPGene* g1, GPGene* g2);
+  GPGene* find (GPGene* g);
+  void grow ();
+
+  Entry** bucket;
+  long numBuckets, numEntries;
+};
+
+
+
+// A temporary file that holds the members of a population that don't
+// fit into memory (GPVariables parameter OutOfCore).  The file is
+// mapped into memory and contains the demes in the compact form
+// GP::pack() writes, one after the other.  A deme is written as a
+// whole with startDeme(), write() and endDeme(), always to the end of
+// the file, and is read by NthDeme() (the pointer is valid until the
+// next write).  Once a deme has been read or written, release() tells
+// the operating system that its pages are not needed in memory any
+// more.  reset() forgets all demes, so the file can be used for the
+// next generation.
+class GPDemeStore
+{
+public:
+  GPDemeStore ();
+  ~GPDemeStore ();
+
+  void startDeme (int deme);
+  char* append (long size);
+  void write (const void* data, long size);
+  void endDeme ();
+  char* NthDeme (int deme);
+  void release (int deme);
+  void reset ();
+
+  long position () { return used; }
+  char* at (long pos) { return map+pos; }
+  long fileSize () { return mapSize; }
+
+private:
+  void grow (long size);
+
+  int fd;
+  char* map;
+  long mapSize, used;
+
+  // Offset and size of each deme in the file (-1 if not written yet)
+  long* demeOffset;
+  long* demeSize;
+  int numDemes, currentDeme;
+};
+
+
+
+// Native code for GPs: The trees are translated into C++ source from
+// the sources of the nodes (GPNodeSet::setSource()) and compiled by
+// the system's compiler into a shared object, which is then loaded.
+// GPs are collected with add() and compiled together by build(),
+// which needs one run of the compiler for many GPs.  function()
+// returns the function of a compiled GP, NULL if it isn't compiled.
+// It has the arguments of GPCode::run() for the main tree.  The
+// functions are kept by the trees of the GP, so GPs with the same
+// trees are compiled only once; they aren't deleted before the
+// GPNativeCompiler.  The prelude is put at the beginning of the
+// source and may define functions for the sources of the nodes.
+// Command is the compiler call (default: see native.cc).  The source
+// and shared object are written to $TMPDIR (or /tmp).
+// exportFunction() writes a GP as a self-contained C function with
+// the prelude (and nothing else needed), optionally with a test
+// program for the given sample contexts and expected results.
+struct GPNativeEntry;
+
+class GPNativeCompiler
+{
+public:
+  GPNativeCompiler (GPAdfNodeSet& adfNs_, char* prelude_, 
+		    char* command_=NULL);
+  ~GPNativeCompiler ();
+
+  void add (GP& gp);
+  void build ();
+  GPPrimitive function (GP& gp);
+
+  int compiled () { return numEntries-queued; }
+
+  void exportFunction (ostream& os, GP& gp, char* name, 
+		       int numSamples=0, int sampleSize=0, 
+		       double* samples=NULL, double* expected=NULL);
+
+private:
+  GPNativeEntry* lookup (GP& gp, int insert);
+  void makeKey (GP& gp);
+  void keyGene (GPGene& g, GPNodeSet& ns);
+  void writeNode (ostream& os, char* name, int* k, int tree);
+  void writeFunction (ostream& os, char* name, char* linkage, 
+		      int* key, int length);
+
+  GPAdfNodeSet* adfNs;
+  char* prelude;
+  char* command;
+
+  // The number of arguments of each tree
+  int* treeArgs;
+
+  // Hash table of the compiled and queued GPs, and the queue of the
+  // next build()
+  GPNativeEntry** table;
+  int tableSize, numEntries;
+  GPNativeEntry** queue;
+  int queueSize, queued;
+
+  // The loaded shared objects
+  void** handle;
+  int handleSize, numHandles;
+
+  // The key of a GP: the node indices of its trees, each tree
+  // preceded by -1
+  int* key;
+  int keySize, keyLength;
+  void addKey (int k);
+};
+
+
+
+// A cache of the results of subtrees, each a vector of numValues
+// values (the results for a number of fitness cases).  Subtrees are
+// found by their keys, which subtreeKeys() calculates for all nodes
+// of a GP in preorder, tree by tree.  It uses the primitives of the
+// node sets (see GPCode) to find ADF calls, whose keys include the
+// key of the called tree, and arguments and gene primitives, whose
+// results depend on more than the structure.  find() returns the
+// values of a key (NULL if not in the cache), insert() the space for
+// the values of a new key, valid until the next insert().  The cache
+// takes no more than the memory budget (in bytes); if it is full,
+// the entry that was used least recently is dropped.  A population
+// selects its cache (GPVariables parameter ResultCacheSize) while it
+// evaluates a GP; GP::runCases() uses the selected cache, with an
+// entry for each block of GPCaseBlockSize cases.
+const int GPCaseBlockSize=64;
+
+class GPResultCache
+{
+public:
+  GPResultCache (int numValues_, long memoryBudget);
+  ~GPResultCache ();
+
+  // Selects a cache (NULL for none) and returns the one that was
+  // selected before
+  static GPResultCache* select (GPResultCache* cache) {
+    GPResultCache* previous=current; current=cache; return previous; }
+  static GPResultCache* selected () { return current; }
+
+  double* find (unsigned long hash, unsigned long check);
+  double* insert (unsigned long hash, unsigned long check);
+
+  static void subtreeKeys (GP& gp, GPAdfNodeSet& adfNs, 
+			   GPResultKey* keys);
+
+  int valuesPerEntry () { return numValues; }
+  long size () { return numEntries; }
+  long capacity () { return maxEntries; }
+  double hitRate () { 
+    return hits+misses ? (double) hits/(double) (hits+misses) : 0.0; }
+  void resetStatistics () { hits=0; misses=0; evictions=0; }
+  void printStatistics (ostream& os);
+
+private:
+  struct Entry
+  {
+    unsigned long hash, check;
+    long next, newer, older;
+  };
+
+  static GPResultKey* keyGene (GPGene& g, GPNodeSet& ns, 
+			       GPResultKey* treeKey, int tree, 
+			       int numTrees, GPResultKey* k);
+  void unlink (long e);
+
+  static GPThreadLocal GPResultCache* current;
+
+  int numValues;
+  Entry* entry;
+  double* values;
+  long* bucket;
+  long numBuckets, numEntries, maxEntries;
+
+  // The list of entries from the most recently used (newest) to the
+  // least recently used (oldest)
+  long newest, oldest;
+
+  long hits, misses, evictions;
+};
+
+
+
+// A table of the fitness of GPs (GPVariables parameter FitnessMemo):
+// GPs with the same structure (see GP::structureKey()) have the same
+// fitness, so the fitness of a GP that was evaluated before is taken
+// from the table rather than calculated again.  This is correct only
+// if the fitness function is deterministic and the genes have no
+// values apart from their node.  The table has a fixed number of
+// entries (rounded up to a power of 2); a GP replaces the one that
+// was at its place before.  find() returns 1 and the fitness, if the
+// key is in the table.
+class GPFitnessTable
+{
+public:
+  GPFitnessTable (long numEntries);
+  ~GPFitnessTable ();
+
+  int find (GPResultKey& key, double& fitness);
+  void insert (GPResultKey& key, double fitness);
+
+  long lookups () { return numLookups; }
+  long hits () { return numHits; }
+
+private:
+  struct Entry
+  {
+    unsigned long hash, check;
+    double fitness;
+    int used;
+  };
+
+  Entry* entry;
+  long size;
+  long numLookups, numHits;
+};
+
+
+
+// A task for a thread pool: run() is called once for each of a
+// number of items, on any thread of the pool.
+class GPTask
+{
+public:
+  virtual ~GPTask () {}
+  virtual void run (int item)=0;
+};
+
+
+
+// A pool of threads that evaluates the GPs of a population
+// (GPVariables parameter EvaluationThreads, 0 for one thread per
+// processor).  The thread that calls run() works as one of them, so
+// a pool of n threads starts n-1 more, which wait for work until the
+// pool is deleted.  Another implementation (e.g. OpenMP) can be
+// plugged in by overriding run() and GPPopulation::createThreadPool().
+//
+// The items are scheduled by work stealing: each thread has a queue
+// of its own, and takes work from the others when it runs out.  If
+// run() is given the estimated cost of each item, the items are
+// dealt out beforehand from the most expensive to the cheapest, each
+// one to the thread with the least work, and each thread starts
+// with its most expensive item; thieves take the cheapest ones.  A
+// task that is run by the pool can split itself into sub-tasks with
+// fork(), which are stolen by threads that ran out of work (used by
+// GP::runCases() for large numbers of cases).  The pool measures how
+// busy its threads are (printStatistics()): the time the threads
+// spent waiting at the end of a run() for the last ones is the
+// effect of badly balanced work on the generation time.
+//
+// The user's GP::evaluate() is called on any thread of the pool, for
+// many GPs at once.  It may change the GP it is called for, but must
+// not change anything that is shared: no global variables (keep the
+// state of the simulation in local variables and give it to the
+// primitives as context), no creating, copying or deleting of GPs or
+// genes, and no output.  It may read data that doesn't change while
+// the population is evaluated.  GPrand() draws from the random
+// stream of the GP.  The fitness table and the result cache are used
+// by the calling thread only.
+class GPThreadPool
+{
+public:
+  GPThreadPool (int numThreads_);
+  virtual ~GPThreadPool ();
+
+  int threads () { return numThreads; }
+
+  // Calls task.run() for the items 0..numItems-1 and returns when
+  // all are done.  cost is the estimated cost of each item, or NULL
+  // if they all cost the same.
+  virtual void run (GPTask& task, int numItems, const double* cost=NULL);
+
+  // Called by a task that is run by a pool: runs the items
+  // 0..numItems-1 of another task on the threads of the pool that
+  // have nothing to do, and returns when all are done.  Outside a
+  // pool, the items are simply run one after the other.
+  static void fork (GPTask& task, int numItems);
+
+  // The pool the calling thread works for (NULL if none)
+  static GPThreadPool* current () { return currentPool; }
+
+  void resetStatistics ();
+  void printStatistics (ostream& os);
+
+protected:
+  int numThreads;
+
+private:
+  static GPThreadLocal GPThreadPool* currentPool;
+  static GPThreadLocal int currentThread;
+
+#if GPTHREADS
+  // An item of a task.  pending counts the items of a fork() that
+  // are not done yet (NULL for the items given to run()).
+  struct Entry
+  {
+    GPTask* task;
+    int item;
+    int* pending;
+  };
+
+  // The queue and the statistics of a thread.  The thread takes the
+  // entries from the tail, thieves from the head.
+  struct Worker
+  {
+    GPThreadPool* pool;
+    pthread_mutex_t lock;
+    Entry* entry;
+    int head, tail, size;
+
+    // The items run and stolen, the time spent on them, and the time
+    // of the items run within a fork() of the current item (which
+    // doesn't count twice) or spent waiting there
+    long items, stolen;
+    double busy, nested;
+  };
+
+  static void* worker (void* pool);
+  void push (int w, Entry& e);
+  int take (int w, Entry& e);
+  void execute (int w, Entry& e);
+  void work (int w);
+  int count (int* counter);
+  int waitForWork (int w, int* counter, Entry& e);
+  void wake ();
+
+  pthread_t* thread;
+  Worker* workers;
+  pthread_mutex_t mutex;
+  pthread_cond_t started, finished, wakeup;
+
+  // The number of items of the current run() that are not done yet.
+  // Each call of run() starts a new round; busy counts the threads
+  // that haven't finished it yet.  firstIdle is the time the first
+  // thread ran out of work in this round.  Idle threads sleep on
+  // wakeup until wake() counts new entries in pushes, or the items
+  // they wait for are done.
+  int remaining, busy, stop;
+  long round, pushes;
+  double firstIdle;
+#endif
+
+  // The number of rounds, their total time and the time some threads
+  // were idle at the end of them
+  long rounds;
+  double wall, tail;
 };
 
 
@@ -501,13 +1574,27 @@ struct GPPopulationRange
 class GPPopulation : public GPContainer
 {
 public:
-  GPPopulation () {}
+  GPPopulation () { adfNs=NULL; arena=NULL; geneTable=NULL; 
+    fitnessTable=NULL; resultCache=NULL; threadPool=NULL; store=NULL; 
+    bestOfPopulation=-1; worstOfPopulation=-1; creationStartIx=0; 
+    avgTimePerNode=0.0; generationNumber=0; }
   GPPopulation (GPVariables& GPVar_, GPAdfNodeSet& adfNs_) : 
-    adfNs(&adfNs_), GPVar(GPVar_) {}
-
-  GPPopulation (const GPPopulation& gpo) : GPContainer(gpo), adfNs(gpo.adfNs)
+    adfNs(adfNs_.share ()), GPVar(GPVar_) { arena=NULL; 
+    geneTable=NULL; fitnessTable=NULL; resultCache=NULL; 
+    threadPool=NULL; store=NULL; bestOfPopulation=-1; 
+    worstOfPopulation=-1; creationStartIx=0; avgTimePerNode=0.0; 
+    generationNumber=0; }
+  virtual ~GPPopulation ();
+
+  GPPopulation (const GPPopulation& gpo) : GPContainer(gpo), 
+    adfNs(gpo.adfNs ? gpo.adfNs->share () : NULL)
     { GPVar=gpo.GPVar; avgFitness=gpo.avgFitness; 
-    avgLength=gpo.avgLength; avgDepth=gpo.avgDepth; }
+    avgLength=gpo.avgLength; avgDepth=gpo.avgDepth; arena=NULL; 
+    geneTable=NULL; fitnessTable=NULL; resultCache=NULL; 
+    threadPool=NULL; store=NULL; bestOfPopulation=gpo.bestOfPopulation;
+    worstOfPopulation=gpo.worstOfPopulation; creationStartIx=0; 
+    avgTimePerNode=gpo.avgTimePerNode; 
+    generationNumber=gpo.generationNumber; }
   virtual GPObject& duplicate () { return *(new GPPopulation(*this)); }
 
   virtual void printOn (ostream& os);
@@ -517,6 +1604,7 @@ public:
   virtual int checkForValidCreation (GP& gpo);
   virtual void create ();
   virtual GP* createGP (int numOfTrees) { return new GP (numOfTrees); }
+  void clear ();
 
   double totalFitness ();
   long totalLength ();
@@ -534,6 +1622,11 @@ public:
   virtual GPContainer* selectParents (GPPopulationRange& range);
   virtual void calculateStatistics ();
   virtual void evaluate();
+  virtual void evaluateMembers (int startIx, int endIx);
+  void recallFitness (int startIx, int endIx);
+  virtual GPThreadPool* createThreadPool (int numThreads) {
+    return new GPThreadPool (numThreads); }
+  virtual double evaluationCost (GP& gp);
 
   virtual void createGenerationReport (int printLegend, int generation,
 				       ostream& fout, ostream& bout);
@@ -557,7 +1650,7 @@ public:
 
 protected:
   // We have to save the function and terminal sets here, because we
-  // need them later
+  // need them later.  The population shares them (see GPNodeSet).
   GPAdfNodeSet* adfNs;
 
   // These are important variables used for the configuration of the
@@ -568,6 +1661,69 @@ protected:
   // calculateStatistics() (which is called by evaluate())
   double avgFitness, avgLength, avgDepth;
 
+  // The arena the members of the population are allocated from, if
+  // the GPVariables parameter ArenaAllocation is set (NULL
+  // otherwise).  It is deleted together with the population.
+  GPArena* arena;
+
+  // The table of all genes of the population, if the GPVariables
+  // parameter HashConsing is set (NULL otherwise).  It is handed on
+  // to the next generation by generate().
+  GPGeneTable* geneTable;
+
+  // The fitness of the GPs evaluated so far, if the GPVariables
+  // parameter FitnessMemo is set (NULL otherwise).  It is handed on
+  // to the next generation by generate() and deleted together with
+  // the population.
+  GPFitnessTable* fitnessTable;
+  void evaluateGP (GP& gp, GPRandomGenerator& stream);
+
+  // The results of the subtrees, if the GPVariables parameter
+  // ResultCacheSize is set (the budget in kilobytes) and all node
+  // sets are pure (NULL otherwise).  Selected while a GP is
+  // evaluated, handed on to the next generation by generate() and
+  // deleted together with the population.
+  GPResultCache* resultCache;
+
+  // The threads the GPs are evaluated on, if the GPVariables
+  // parameter EvaluationThreads is not 1 (NULL otherwise).  Created
+  // by evaluateGPs() with createThreadPool(), handed on to the next
+  // generation by generate() and deleted together with the
+  // population.
+  GPThreadPool* threadPool;
+  virtual void evaluateGPs (GP** gps, int* numbers, int numGPs);
+
+  // The average time per node of the GPs evaluated on the thread
+  // pool, for the cost of GPs that were never evaluated there
+  double avgTimePerNode;
+
+  // The file the members are kept in, if the GPVariables parameter
+  // OutOfCore is set (NULL otherwise).  Only one deme at a time is
+  // paged in (plus the best and the worst of the population, which
+  // stay in memory); the other entries of the container are NULL.
+  GPDemeStore* store;
+  void pageIn (int deme);
+  void pageOut (int deme, int writeBack);
+  void storedStatistics ();
+
+  // The member checkForDiversity() starts comparing with
+  int creationStartIx;
+
+  // The number of the generation (0 for the one create() made), which
+  // is part of the keys of the random streams.  It is not saved, a
+  // loaded population starts again with 0.  createRandomStream()
+  // returns a new generator for the given part of the run (a
+  // GPRandomStream), which the caller deletes; override it to plug in
+  // another generator.  randomStream() does the same for the
+  // individual with the given number (its index in the population) of
+  // this generation.
+  int generationNumber;
+  virtual GPRandomGenerator* createRandomStream (int generation, int deme,
+						 int individual, 
+						 GPRandomUse use) {
+    return new GPRandomStream (generation, deme, individual, use); }
+  GPRandomGenerator* randomStream (int number, GPRandomUse use);
+
 private:
   // These variables are needed only for the probablistic selection
   // method and are calculated anew for every deme or population.  So
@@ -584,5 +1740,86 @@ private:
 
 
 
+
+// ------------------------------------------------------------------
+
+
+
+// Templates for the user's classes.  Derive your gene, GP and
+// population classes from them instead of GPGene, GP and GPPopulation
+// and give the derived class itself as first template parameter, for
+// example
+//
+//   class MyGene : public GPGeneT<MyGene> { ... };
+//   class MyGP : public GPT<MyGP, MyGene> { ... };
+//   class MyPopulation : public GPPopulationT<MyPopulation, MyGP> 
+//     { ... };
+//
+// They provide duplicate(), createChild(), createGene() and
+// createGP(), so that the derived classes need only constructors
+// (createObject() for load/save must still be defined by the user, as
+// the classes need not have a default constructor).  NthChild(),
+// NthGene() and NthGP() return the derived classes, so no casts are
+// necessary in the user's tree walks.  The functions the evaluation
+// asks for every gene, isFunction() and isTerminal(), are final, so
+// the compiler calls them directly and can inline them when a walk
+// goes through the derived class.  The objects are still GPGene, GP
+// and GPPopulation objects, so all genetic operators, load and save
+// work as before.
+template <class Derived>
+class GPGeneT : public GPGene
+{
+public:
+  GPGeneT () {}
+  GPGeneT (GPNode& gpo) : GPGene (gpo) {}
+  GPGeneT (const GPGeneT& gpo) : GPGene (gpo) {}
+  virtual GPObject& duplicate () { 
+    return *(new Derived (*(Derived*) this)); }
+  virtual GPGene* createChild (GPNode& gpo) { 
+    return new Derived (gpo); }
+
+  virtual int isFunction () final { return node->isFunction (); }
+  virtual int isTerminal () final { return node->isTerminal (); }
+
+  Derived* NthChild (int n) { 
+    return (Derived*) GPContainer::Nth (n); }
+};
+
+
+
+template <class Derived, class Gene>
+class GPT : public GP
+{
+public:
+  GPT () {}
+  GPT (int trees) : GP (trees) {}
+  GPT (const GPT& gpo) : GP (gpo) {}
+  virtual GPObject& duplicate () { 
+    return *(new Derived (*(Derived*) this)); }
+  virtual GPGene* createGene (GPNode& gpo) { 
+    return new Gene (gpo); }
+
+  Gene* NthGene (int n) { return (Gene*) GPContainer::Nth (n); }
+};
+
+
+
+template <class Derived, class GPType>
+class GPPopulationT : public GPPopulation
+{
+public:
+  GPPopulationT () {}
+  GPPopulationT (GPVariables& GPVar_, GPAdfNodeSet& adfNs_) : 
+    GPPopulation (GPVar_, adfNs_) {}
+  GPPopulationT (const GPPopulationT& gpo) : GPPopulation (gpo) {}
+  virtual GPObject& duplicate () { 
+    return *(new Derived (*(Derived*) this)); }
+  virtual GP* createGP (int numOfTrees) { 
+    return new GPType (numOfTrees); }
+
+  GPType* NthGP (int n) { return (GPType*) GPContainer::Nth (n); }
+};
+
+
 #endif
 
@@ -0,0 +1,168 @@
+
+// gpprim.h
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Genetic Program class definitions
+
+// Primitive sets declared at compile time
+
+
+
+#ifndef __GPPRIM_H
+#define __GPPRIM_H
+
+#include "gp.h"
+
+
+
+// A primitive set is declared by a list of types, one for each node.
+// A primitive is derived from GPPrimitiveT with the number of its
+// arguments, and defines its name and an evaluation function that
+// gets the arguments of the node, for example
+//
+//   struct Add : public GPPrimitiveT<2>
+//   {
+//     static const char* name () { return "+"; }
+//     template <class Arguments> 
+//     static double evaluate (Arguments& a) { return a[0]+a[1]; }
+//   };
+//
+//   typedef GPPrimitiveSetT<double, MyContext, Add, Sub, X> MySet;
+//
+// a[n] evaluates the n-th argument, so an argument that is not used
+// is not evaluated, and the primitive decides the order (IF-nodes,
+// sequences).  a.context is the context the evaluation started with,
+// and a.gene the gene of the node.
+//
+// The node value of a primitive (and so its ID when a population is
+// loaded or saved) is its position in the set, given by id<>().
+// createNodes() puts the nodes into a node set.  evaluate() calls
+// the evaluation function of the node of a gene through a table
+// instead of a switch statement; each entry of the table is compiled
+// for one primitive, so the compiler inlines the whole evaluation
+// function there.
+template <int Arity>
+struct GPPrimitiveT
+{
+  static const int arity=Arity;
+};
+
+
+
+// The position of type Q in a list of types
+template <class Q, class... List> struct GPIndexOf;
+
+template <class Q, class... List> 
+struct GPIndexOf<Q, Q, List...>
+{
+  static const int value=0;
+};
+
+template <class Q, class Head, class... List> 
+struct GPIndexOf<Q, Head, List...>
+{
+  static const int value=1+GPIndexOf<Q, List...>::value;
+};
+
+
+
+// The arguments of a node as seen by the evaluation function of its
+// primitive
+template <class Set>
+class GPArgumentsT
+{
+public:
+  typedef typename Set::Value Value;
+  typedef typename Set::Context Context;
+
+  GPArgumentsT (GPGene& gene_, Context& context_) : 
+    gene (gene_), context (context_) {}
+
+  Value operator [] (int n) { 
+    return Set::evaluate (*gene.NthChild (n), context); }
+
+  GPGene& gene;
+  Context& context;
+};
+
+
+
+template <class ValueType, class ContextType, class... Primitives>
+class GPPrimitiveSetT
+{
+public:
+  typedef ValueType Value;
+  typedef ContextType Context;
+  typedef GPArgumentsT<GPPrimitiveSetT> Arguments;
+
+  static const int size=sizeof... (Primitives);
+
+  template <class Q> 
+  static constexpr int id () { return GPIndexOf<Q, Primitives...>::value; }
+
+  static void createNodes (GPNodeSet& ns) {
+    int dummy[]={ (ns.putNode (*new GPNode (id<Primitives> (), 
+					    (char*) Primitives::name (), 
+					    Primitives::arity)), 0)... };
+    (void) dummy; }
+
+  static Value evaluate (GPGene& g, Context& c) {
+    static Value (* const table[]) (GPGene&, Context&)=
+      { &call<Primitives>... };
+    int v=g.geneNode ().value ();
+#if GPINTERNALCHECK
+    if (v<0 || v>=size)
+      GPExitSystem ("GPPrimitiveSetT::evaluate", 
+		    "Node value not in primitive set");
+#endif
+    return table[v] (g, c); }
+
+private:
+  template <class Q>
+  static Value call (GPGene& g, Context& c) {
+    Arguments a (g, c); 
+    return Q::evaluate (a); }
+};
+
+
+#endif
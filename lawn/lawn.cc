@@ -97,6 +97,7 @@ double lengthFactor=1/100.0;
 // just add them below and insert an entry in the configArray.
 GPVariables cfg;
 char *InfoFileName="data";
+int Interpreter=0;
 struct GPConfigVarInformation configArray[]=
 {
   {"PopulationSize", DATAINT, &cfg.PopulationSize},
@@ -116,19 +117,21 @@ struct GPConfigVarInformation configArray[]=
   {"AddBestToNewPopulation", DATAINT, &cfg.AddBestToNewPopulation},
   {"InfoFileName", DATASTRING, &InfoFileName},
   {"SteadyState", DATAINT, &cfg.SteadyState},
+  {"ArenaAllocation", DATAINT, &cfg.ArenaAllocation},
+  {"Recycling", DATAINT, &cfg.Recycling},
+  {"FitnessMemo", DATAINT, &cfg.FitnessMemo},
+  {"ResultCacheSize", DATAINT, &cfg.ResultCacheSize},
+  {"EvaluationThreads", DATAINT, &cfg.EvaluationThreads},
   {"LengthFactor", DATADOUBLE, &lengthFactor},
+  {"Interpreter", DATAINT, &Interpreter},
   {"", DATAINT, NULL}
 };
 
-// The mower on the lawn
-Mower mower;
-
 // A zero vector
 Vector zeroVector (0, 0);
 
-// Used for printing the lawn to a file during evaluation
-int printLawn=0;
-ofstream lawnFile;
+// The function and terminal sets
+GPAdfNodeSet adfNs;
 
 
 
@@ -146,23 +149,55 @@ void MyGene::printOn (ostream& os)
 
 
 
+// Two genes are only the same if their random vectors are the same,
+// too.  The children are compared by GPGene::compare().
+int MyGene::compare (GPGene& g)
+{
+  if (GPGene::compare (g))
+    return 1;
+  MyGene& mg=(MyGene&) g;
+  if (node->value()==RV)
+    return randomConstant.x!=mg.randomConstant.x 
+      || randomConstant.y!=mg.randomConstant.y;
+  return 0;
+}
+
+
+
+// The key of a random vector includes its value
+GPResultKey MyGene::structureKey ()
+{
+  GPResultKey key=GPGene::structureKey ();
+  if (node->value()==RV)
+    {
+      unsigned long v=randomConstant.x*LawnVertical+randomConstant.y;
+      GPResultKey value={GPMixHash (v+1), GPMixHash (~v), 0, 0};
+      GPAddKey (key, value);
+    }
+  return key;
+}
+
+
+
 // We have the freedom to define this function in any way we like.
-// Variable gp is used to be able to evaluate the ADF trees of the GP.
-// arg0 is the argument for ADF1.  It's recursive of course.
-Vector MyGene::evaluate (MyGP& gp, Vector arg0=zeroVector)
+// Variable gp is used to be able to evaluate the ADF trees of the GP,
+// the mower is the one that is moved by it.  arg0 is the argument for
+// ADF1, and is handed down to all genes of its tree.  It's recursive
+// of course.
+Vector MyGene::evaluate (MyGP& gp, Mower& mower, Vector arg0=zeroVector)
 {
   // Print the lawn?
 //     {
 //       static int print=1;
 //       if (print)
-// 	lawnFile << mower << '\n' << '\n';
+// 	*mower.trace << mower << '\n' << '\n';
 //       print=node->value ()==MOW || node->value ()==FROG;
 //     }
 //   else
 
   // Stop if all is mown (Speeds things up), but only, if the
   // printmode is not active.
-  if (!printLawn && mower.mown==LawnHorizontal*LawnVertical)
+  if (!mower.trace && mower.mown==LawnHorizontal*LawnVertical)
     return zeroVector;
 
   Vector arg;
@@ -178,29 +213,22 @@ Vector MyGene::evaluate (MyGP& gp, Vector arg0=zeroVector)
       // Mow and return (0,0) according to Koza
       mower.mow ();
       // Print the lawn after the mow.
-      if (printLawn)
-	lawnFile << mower << '\n' << '\n';
+      if (mower.trace)
+	*mower.trace << mower << '\n' << '\n';
       return zeroVector;
       
     case RV:
-      // Random position. If a value has not yet been assigned, do it
-      // now
-      if (!valueAssigned)
-	{
-	  valueAssigned=1;
-	  randomConstant.x=GPrand () % LawnHorizontal;
-	  randomConstant.y=GPrand () % LawnVertical;
-	}
+      // Random position, assigned when the gene was created
       return randomConstant;
       
     case ADF0:
       // No argument for ADF0
-      return gp.NthMyGene (1)->evaluate (gp);
+      return gp.NthMyGene (1)->evaluate (gp, mower);
       
     case ADF1:
       // One argument for ADF1
       return gp.NthMyGene(2)->
-	evaluate (gp, NthMyChild(0)->evaluate (gp));
+	evaluate (gp, mower, NthMyChild(0)->evaluate (gp, mower, arg0));
       
     case ARG0:
       // Argument for ADF1
@@ -208,25 +236,26 @@ Vector MyGene::evaluate (MyGP& gp, Vector arg0=zeroVector)
       
     case FROG:
       // Jump to new position and mow
-      arg=NthMyChild(0)->evaluate (gp);
+      arg=NthMyChild(0)->evaluate (gp, mower, arg0);
       mower.frog (arg);
       // Print the lawn after the jump.
-      if (printLawn)
-	lawnFile << mower << '\n' << '\n';
+      if (mower.trace)
+	*mower.trace << mower << '\n' << '\n';
       // Identity operator: returns the same
       return arg;
       
     case PROGN:
       // Evaluate first child
-      NthMyChild(0)->evaluate (gp);
+      NthMyChild(0)->evaluate (gp, mower, arg0);
       
       // Return evaluation from second child
-      return NthMyChild(1)->evaluate (gp);
+      return NthMyChild(1)->evaluate (gp, mower, arg0);
       
     case VA:
-      // Vector addition
-      return NthMyChild(0)->evaluate (gp)
-	+ NthMyChild(1)->evaluate (gp);
+      // Vector addition.  The first argument is evaluated first (the
+      // order of the operands of + is not defined).
+      arg=NthMyChild(0)->evaluate (gp, mower, arg0);
+      return arg+NthMyChild(1)->evaluate (gp, mower, arg0);
 
     default: 
       GPExitSystem ("MyGene::evaluate", "Undefined function value");
@@ -238,19 +267,71 @@ Vector MyGene::evaluate (MyGP& gp, Vector arg0=zeroVector)
 
 
 
+// The primitives for the compiled evaluation (configuration
+// parameter Interpreter=1).  They do the same as MyGene::evaluate().
+// The values on the stack are vectors coded as x+y*LawnHorizontal,
+// which is exact for a double.  The context is the mower.
+inline double code (Vector v) { return v.x+v.y*LawnHorizontal; }
+inline Vector decode (double d) { 
+  int i=(int) d; return Vector (i%LawnHorizontal, i/LawnHorizontal); }
+
+static double primLeft (double*, void* mower) { 
+  ((Mower*) mower)->left (); return 0; }
+static double primMow (double*, void* context) 
+{ 
+  Mower& mower=*(Mower*) context;
+  mower.mow ();
+  if (mower.trace)
+    *mower.trace << mower << '\n' << '\n';
+  return 0;
+}
+static double primRV (double*, void* gene) 
+{ 
+  return code (((MyGene*) (GPGene*) gene)->randomConstant);
+}
+static double primFrog (double* a, void* context) 
+{ 
+  Mower& mower=*(Mower*) context;
+  Vector arg=decode (a[0]);
+  mower.frog (arg);
+  if (mower.trace)
+    *mower.trace << mower << '\n' << '\n';
+  return a[0];
+}
+static double primProgn (double* a, void*) { return a[1]; }
+static double primVA (double* a, void*) { 
+  return code (decode (a[0])+decode (a[1])); }
+
+
+
 // Evaluate the fitness of a GP and save it into the class variable
-// fitness.
+// fitness.  The mower is a local variable, so that GPs can be
+// evaluated on several threads at once (configuration parameter
+// EvaluationThreads).
 void MyGP::evaluate ()
+{
+  Mower mower;
+  mowLawn (mower);
+}
+
+
+
+// Let the GP mow the lawn and save the fitness
+void MyGP::mowLawn (Mower& mower)
 {
   // Prepare lawn for mowing
   mower.reset ();
   
   // Print the unmown lawn
-  if (printLawn)
-    lawnFile << mower << '\n' << '\n';
+  if (mower.trace)
+    *mower.trace << mower << '\n' << '\n';
 
-  // Evaluate main tree
-  NthMyGene (0)->evaluate (*this);
+  // Evaluate main tree, either gene by gene or compiled and run by
+  // the kernel
+  if (Interpreter)
+    run (adfNs, &mower);
+  else
+    NthMyGene (0)->evaluate (*this, mower);
   
   // Save standardized fitness in object
   double fitness=(double)(LawnHorizontal*LawnVertical-mower.mown)
@@ -304,6 +385,23 @@ void createNodeSet (GPAdfNodeSet& adfNs)
   ns2.putNode (*new GPNode (FROG, "FROG", 1));
   ns2.putNode (*new GPNode (VA, "VA", 2));
   ns2.putNode (*new GPNode (PROGN, "PROGN", 2));
+
+  // The primitives for the compiled evaluation
+  for (int n=0; n<3; n++)
+    {
+      GPNodeSet& ns=*adfNs.NthNodeSet (n);
+      ns.setPrimitive (LEFT, primLeft);
+      ns.setPrimitive (MOW, primMow);
+      ns.setGenePrimitive (RV, primRV);
+      ns.setPrimitive (VA, primVA);
+      ns.setPrimitive (PROGN, primProgn);
+    }
+  ns0.setAdfCall (ADF0, 1);
+  ns0.setAdfCall (ADF1, 2);
+  ns0.setPrimitive (FROG, primFrog);
+  ns2.setArgument (ARG0, 0);
+  ns2.setAdfCall (ADF0, 1);
+  ns2.setPrimitive (FROG, primFrog);
 }
 
 
@@ -345,7 +443,6 @@ int main ()
   cout << cfg << endl;
   
   // Create the adf function/terminal set and print it out.
-  GPAdfNodeSet adfNs;
   createNodeSet (adfNs);
   cout << adfNs << endl; 
   fout << adfNs << endl;  
@@ -368,15 +465,27 @@ int main ()
     {
       // Create a new generation from the old one by applying the
       // genetic operators
-      if (!cfg.SteadyState)
+      if (!cfg.SteadyState && !newPop)
 	newPop=new MyPopulation (cfg, adfNs);
       pop->generate (*newPop);
       
-      // Delete the old generation and make the new the old one
+      // Delete the old generation and make the new the old one.  If
+      // Recycling is set, the old generation is only emptied and
+      // becomes the new population of the next generation.
       if (!cfg.SteadyState)
 	{
-	  delete pop;
+	  MyPopulation* oldPop=pop;
 	  pop=newPop;
+	  if (cfg.Recycling)
+	    {
+	      newPop=oldPop;
+	      newPop->clear ();
+	    }
+	  else
+	    {
+	      delete oldPop;
+	      newPop=NULL;
+	    }
 	}
 
       // Create a report of this generation and how well it is doing
@@ -388,9 +497,10 @@ int main ()
 
   // Print lawn to a text file while evaluating the best one of the
   // last generation
-  printLawn=1;
-  lawnFile.open (strLawnFile.str());
-  pop->NthMyGP(pop->bestOfPopulation)->evaluate();
+  ofstream lawnFile (strLawnFile.str());
+  Mower mower;
+  mower.trace=&lawnFile;
+  pop->NthMyGP(pop->bestOfPopulation)->mowLawn (mower);
   lawnFile.close ();
 
   cout << "\nResults are in " 
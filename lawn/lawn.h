@@ -85,6 +85,8 @@ inline ostream& operator << (ostream &os, Vector &v)
 class Mower
 {
 public:
+  Mower () { trace=NULL; }
+
   void reset ();
 
   void left ();
@@ -104,6 +106,10 @@ public:
   // Direction the mower is facing (value 0-3) and how many areas are
   // already mown
   int direction, mown;
+
+  // The stream the lawn is printed to after every move (NULL for
+  // none)
+  ostream* trace;
 };
 
 
@@ -119,12 +125,19 @@ class MyGene : public GPGene
 {
 public:
   // The constructor
-  MyGene (GPNode& gpo) : GPGene (gpo) { valueAssigned=0; }
+  // The constructor.  A random vector gets its value when it is
+  // created, so that the evaluation doesn't need random numbers.
+  MyGene (GPNode& gpo) : GPGene (gpo) { 
+    if (gpo.value ()==RV)
+      {
+	randomConstant.x=GPRandomBelow (LawnHorizontal);
+	randomConstant.y=GPRandomBelow (LawnVertical);
+      }
+  }
 
   // Copy constructor and the function duplicate used by the container
   // class
   MyGene (const MyGene& gpo) : GPGene (gpo) { 
-    valueAssigned=gpo.valueAssigned;
     randomConstant=gpo.randomConstant; }
   virtual GPObject& duplicate () { return *(new MyGene(*this)); }
 
@@ -139,11 +152,14 @@ public:
 
   virtual void printOn (ostream& os);
 
-  Vector evaluate (MyGP& gp, Vector arg0);
+  // Random vectors with different values are different, for the
+  // comparison as well as for the key of the fitness table
+  virtual int compare (GPGene& g);
+  virtual GPResultKey structureKey ();
+
+  Vector evaluate (MyGP& gp, Mower& mower, Vector arg0);
 
-  // If this node is a real constant, we need information what constant 
-  // and whether it is already assigned a random value
-  int valueAssigned; 
+  // If this node is a random vector, its value
   Vector randomConstant;
 };
 
@@ -170,6 +186,7 @@ public:
     return (MyGene*) GPContainer::Nth (n); }
 
   virtual void evaluate ();
+  void mowLawn (Mower& mower);
 
   // The percentage mown by the GP
   double mown;
@@ -78,6 +78,13 @@ struct GPConfigVarInformation configArray[]=
   {"ShrinkMutationProbability", DATADOUBLE, &cfg.ShrinkMutationProbability},
   {"AddBestToNewPopulation", DATAINT, &cfg.AddBestToNewPopulation},
   {"SteadyState", DATAINT, &cfg.SteadyState},
+  {"ArenaAllocation", DATAINT, &cfg.ArenaAllocation},
+  {"HashConsing", DATAINT, &cfg.HashConsing},
+  {"Recycling", DATAINT, &cfg.Recycling},
+  {"OutOfCore", DATAINT, &cfg.OutOfCore},
+  {"FitnessMemo", DATAINT, &cfg.FitnessMemo},
+  {"ResultCacheSize", DATAINT, &cfg.ResultCacheSize},
+  {"EvaluationThreads", DATAINT, &cfg.EvaluationThreads},
   {"", DATAINT, NULL}
 };
 
@@ -312,15 +319,27 @@ int main ()
     {
       // Create a new generation from the old one by applying the
       // genetic operators
-      if (!cfg.SteadyState)
+      if (!cfg.SteadyState && !newPop)
 	newPop=new MyPopulation (cfg, adfNs);
       pop->generate (*newPop);
       
-      // Delete the old generation and make the new the old one
+      // Delete the old generation and make the new the old one.  If
+      // Recycling is set, the old generation is only emptied and
+      // becomes the new population of the next generation.
       if (!cfg.SteadyState)
 	{
-	  delete pop;
+	  MyPopulation* oldPop=pop;
 	  pop=newPop;
+	  if (cfg.Recycling)
+	    {
+	      newPop=oldPop;
+	      newPop->clear ();
+	    }
+	  else
+	    {
+	      delete oldPop;
+	      newPop=NULL;
+	    }
 	}
 
       // Create a report of this generation and how well it is doing
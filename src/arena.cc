@@ -0,0 +1,221 @@
+
+// arena.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Memory management of the kernel.  Every block handed out by
+// GPAllocate() is preceded by a small header that tells where the
+// block came from, so GPFree() knows whether to give it back to the
+// heap or to ignore it because it belongs to an arena.
+
+#include <new>
+#include "gp.h"
+
+
+
+// The header of each block.  The union makes sure that the block
+// following the header is aligned properly for any data type used by
+// the kernel.
+union GPBlockHeader
+{
+  GPArena* arena;
+  double alignDouble;
+  long alignLong;
+};
+
+// Blocks are rounded up to a multiple of this size
+const size_t blockAlignment=sizeof (GPBlockHeader);
+
+// The currently selected arena
+GPArena* GPArena::current=NULL;
+
+
+
+// Allocate a block either from the selected arena or from the heap.
+// We use the global operator new for the heap, so that a new-handler
+// installed by the user is called if we run out of memory.
+void* GPAllocate (size_t size)
+{
+  GPBlockHeader* h;
+  if (GPArena::selected ())
+    h=(GPBlockHeader*) GPArena::selected ()->
+      allocate (size+sizeof (GPBlockHeader));
+  else
+    h=(GPBlockHeader*) ::operator new (size+sizeof (GPBlockHeader));
+  h->arena=GPArena::selected ();
+  return h+1;
+}
+
+
+
+// Free a block.  If it belongs to an arena, nothing is done.
+void GPFree (void* p)
+{
+  if (p)
+    {
+      GPBlockHeader* h=((GPBlockHeader*) p)-1;
+      if (!h->arena)
+	::operator delete (h);
+    }
+}
+
+
+
+// Constructor.  No memory is allocated until the first request.
+GPArena::GPArena (size_t slabSize_)
+{
+  slabs=NULL;
+  spareSlabs=NULL;
+  largeSlabs=NULL;
+  freePtr=NULL;
+  freeSize=0;
+  slabSize=slabSize_;
+  allocated=0;
+}
+
+
+
+// Destructor.  Give back all slabs, and thus every block that was
+// allocated from the arena.
+GPArena::~GPArena ()
+{
+#if GPINTERNALCHECK
+  if (current==this)
+    GPExitSystem ("GPArena::~GPArena", "Arena is still selected");
+#endif
+
+  reset ();
+  while (spareSlabs)
+    {
+      Slab* next=spareSlabs->next;
+      ::operator delete (spareSlabs);
+      spareSlabs=next;
+    }
+}
+
+
+
+// Give back every block that was allocated from the arena, but keep
+// the slabs to use them again.  Only the slabs of blocks that were
+// too big for a normal slab are given back to the heap.
+void GPArena::reset ()
+{
+  while (slabs)
+    {
+      Slab* next=slabs->next;
+      slabs->next=spareSlabs;
+      spareSlabs=slabs;
+      slabs=next;
+    }
+  while (largeSlabs)
+    {
+      Slab* next=largeSlabs->next;
+      ::operator delete (largeSlabs);
+      largeSlabs=next;
+    }
+  freePtr=NULL;
+  freeSize=0;
+  allocated=0;
+}
+
+
+
+// Allocate a block of the given size.  If the current slab is full,
+// a new one is started; the rest of the old one is wasted.  Blocks
+// that are too big to fit a slab get a slab of their own.
+void* GPArena::allocate (size_t size)
+{
+  size=(size+blockAlignment-1) / blockAlignment * blockAlignment;
+  allocated+=size;
+
+  // The slab header takes the space of one block header to keep the
+  // alignment
+  const size_t slabHeader=sizeof (GPBlockHeader);
+
+  if (size>slabSize)
+    {
+      Slab* s=(Slab*) ::operator new (slabHeader+size);
+      s->next=largeSlabs;
+      largeSlabs=s;
+      return ((char*) s)+slabHeader;
+    }
+
+  if (size>freeSize)
+    {
+      // Use a slab of the spare ones, if there is any
+      Slab* s;
+      if (spareSlabs)
+	{
+	  s=spareSlabs;
+	  spareSlabs=s->next;
+	}
+      else
+	s=(Slab*) ::operator new (slabHeader+slabSize);
+      s->next=slabs;
+      slabs=s;
+      freePtr=((char*) s)+slabHeader;
+      freeSize=slabSize;
+    }
+
+  void* p=freePtr;
+  freePtr+=size;
+  freeSize-=size;
+  return p;
+}
+
+
+
+// Select the arena memory is taken from.  
+GPArena* GPArena::select (GPArena* arena)
+{
+  GPArena* previous=current;
+  current=arena;
+  return previous;
+}
+
+
+
+// Returns the arena a block was allocated from
+GPArena* GPArena::owner (void* p)
+{
+  return (((GPBlockHeader*) p)-1)->arena;
+}
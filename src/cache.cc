@@ -0,0 +1,331 @@
+
+// cache.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// A cache of the results of subtrees (see class GPResultCache) and
+// a table of the fitness of GPs (see class GPFitnessTable)
+
+#include "gp.h"
+
+using namespace std;
+
+
+// The selected cache of each thread
+GPThreadLocal GPResultCache* GPResultCache::current=NULL;
+
+
+
+// Constructor.  As many entries are allocated at once as fit into
+// the memory budget, together with the hash table.
+GPResultCache::GPResultCache (int numValues_, long memoryBudget)
+{
+  numValues=numValues_;
+  long entrySize=sizeof (Entry)+numValues*sizeof (double)
+    +sizeof (long);
+  maxEntries=memoryBudget/entrySize;
+  if (numValues<1 || maxEntries<1)
+    GPExitSystem ("GPResultCache::GPResultCache", 
+		  "Memory budget too small");
+
+  for (numBuckets=1; numBuckets<maxEntries; numBuckets*=2)
+    ;
+  maxEntries=(memoryBudget-numBuckets*sizeof (long))
+    /(entrySize-sizeof (long));
+  if (maxEntries<1)
+    maxEntries=1;
+
+  entry=new Entry[maxEntries];
+  values=new double[maxEntries*numValues];
+  bucket=new long[numBuckets];
+  for (long n=0; n<numBuckets; n++)
+    bucket[n]=-1;
+  numEntries=0;
+  newest=-1;
+  oldest=-1;
+  resetStatistics ();
+}
+
+
+
+// Destructor
+GPResultCache::~GPResultCache ()
+{
+  delete [] entry;
+  delete [] values;
+  delete [] bucket;
+}
+
+
+
+// Removes an entry from the list of use.  It stays in its bucket.
+void GPResultCache::unlink (long e)
+{
+  if (entry[e].newer>=0)
+    entry[entry[e].newer].older=entry[e].older;
+  else
+    newest=entry[e].older;
+  if (entry[e].older>=0)
+    entry[entry[e].older].newer=entry[e].newer;
+  else
+    oldest=entry[e].newer;
+}
+
+
+
+// Returns the values of a key, or NULL if it isn't in the cache.  The
+// entry becomes the most recently used one.
+double* GPResultCache::find (unsigned long hash, unsigned long check)
+{
+  for (long e=bucket[hash & (numBuckets-1)]; e>=0; e=entry[e].next)
+    if (entry[e].hash==hash && entry[e].check==check)
+      {
+	hits++;
+	if (e!=newest)
+	  {
+	    unlink (e);
+	    entry[e].older=newest;
+	    entry[e].newer=-1;
+	    entry[newest].newer=e;
+	    newest=e;
+	  }
+	return values+e*numValues;
+      }
+
+  misses++;
+  return NULL;
+}
+
+
+
+// Puts a key into the cache and returns the space for its values.
+// If the cache is full, the least recently used entry is dropped.
+// The key must not be in the cache already.
+double* GPResultCache::insert (unsigned long hash, unsigned long check)
+{
+  long e;
+  if (numEntries<maxEntries)
+    e=numEntries++;
+  else
+    {
+      // Take the oldest entry out of its bucket and the list
+      e=oldest;
+      long* ePtr=&bucket[entry[e].hash & (numBuckets-1)];
+      while (*ePtr!=e)
+	ePtr=&entry[*ePtr].next;
+      *ePtr=entry[e].next;
+      unlink (e);
+      evictions++;
+    }
+
+  long b=hash & (numBuckets-1);
+  entry[e].hash=hash;
+  entry[e].check=check;
+  entry[e].next=bucket[b];
+  bucket[b]=e;
+  entry[e].older=newest;
+  entry[e].newer=-1;
+  if (newest>=0)
+    entry[newest].newer=e;
+  else
+    oldest=e;
+  newest=e;
+
+  return values+e*numValues;
+}
+
+
+
+// Calculates the keys of a gene and its children in preorder,
+// starting with k, and returns the pointer behind the last one.  The
+// hash values are calculated from the address of the node and the
+// keys of the children (and of the called tree for an ADF call) in
+// two different ways.
+GPResultKey* GPResultCache::keyGene (GPGene& g, GPNodeSet& ns, 
+				     GPResultKey* treeKey, int tree, 
+				     int numTrees, GPResultKey* k)
+{
+  GPResultKey& key=*k++;
+  unsigned long node=(unsigned long) &g.geneNode ();
+  key.hash=GPMixHash (node);
+  key.check=GPMixHash (node*0x9e3779b97f4a7c15UL+0x632be59bd9b4e019UL);
+  key.length=1;
+  key.flags=ns.isPure () ? 0 : GPResultImpure;
+
+  for (int n=0; n<g.containerSize (); n++)
+    {
+      GPResultKey& child=*k;
+      k=keyGene (*g.NthChild (n), ns, treeKey, tree, numTrees, k);
+      GPAddKey (key, child);
+      key.length+=child.length;
+      key.flags|=child.flags;
+    }
+
+  GPInstruction* i=ns.NthPrimitive (ns.indexOfNode (&g.geneNode ()));
+  if (i)
+    switch (i->opcode)
+      {
+      case GPArgument:
+	key.flags|=GPResultDependsOnArguments;
+	break;
+      case GPGeneCall:
+	key.flags|=GPResultDependsOnGene;
+	break;
+      case GPAdfCall:
+	// The called tree has its key already, if it comes after this
+	// one.  Its arguments are given by this call.
+	if (i->operand>tree && i->operand<numTrees)
+	  {
+	    GPResultKey& called=treeKey[i->operand];
+	    GPAddKey (key, called);
+	    key.flags|=called.flags & ~GPResultDependsOnArguments;
+	  }
+	else
+	  key.flags|=GPResultDependsOnGene;
+	break;
+      }
+
+  return k;
+}
+
+
+
+// Calculates the keys of all nodes of a GP: the nodes of each tree
+// in preorder, the trees one after the other.  keys must have space
+// for gp.length() keys.  ADFs may only call trees with a higher
+// number, so the trees are done from the last to the first.
+void GPResultCache::subtreeKeys (GP& gp, GPAdfNodeSet& adfNs, 
+				 GPResultKey* keys)
+{
+  int numTrees=gp.containerSize ();
+  int* start=new int[numTrees];
+  GPResultKey* treeKey=new GPResultKey[numTrees];
+
+  int length=0;
+  for (int n=0; n<numTrees; n++)
+    {
+      start[n]=length;
+      if (gp.NthGene (n))
+	length+=gp.NthGene (n)->length ();
+    }
+
+  for (int n=numTrees-1; n>=0; n--)
+    {
+      GPGene* g=gp.NthGene (n);
+      if (g)
+	{
+	  keyGene (*g, *adfNs.NthNodeSet (n), treeKey, n, numTrees, 
+		   keys+start[n]);
+	  treeKey[n]=keys[start[n]];
+	}
+      else
+	{
+	  treeKey[n].hash=0;
+	  treeKey[n].check=0;
+	  treeKey[n].length=0;
+	  treeKey[n].flags=GPResultDependsOnGene;
+	}
+    }
+
+  delete [] start;
+  delete [] treeKey;
+}
+
+
+
+// Prints the number of hits and misses with the hit rate
+void GPResultCache::printStatistics (ostream& os)
+{
+  os << "Result cache: " << hits << " hits, " << misses << " misses ("
+     << 100.0*hitRate () << "%), " << evictions << " evicted, "
+     << numEntries << " of " << maxEntries << " entries used" << endl;
+}
+
+
+
+// Constructor
+GPFitnessTable::GPFitnessTable (long numEntries)
+{
+  for (size=1; size<numEntries; size*=2)
+    ;
+  entry=new Entry[size];
+  for (long n=0; n<size; n++)
+    entry[n].used=0;
+  numLookups=0;
+  numHits=0;
+}
+
+
+
+// Destructor
+GPFitnessTable::~GPFitnessTable ()
+{
+  delete [] entry;
+}
+
+
+
+// Looks for the fitness of a GP with the given key
+int GPFitnessTable::find (GPResultKey& key, double& fitness)
+{
+  Entry& e=entry[key.hash & (size-1)];
+  numLookups++;
+  if (e.used && e.hash==key.hash && e.check==key.check)
+    {
+      numHits++;
+      fitness=e.fitness;
+      return 1;
+    }
+  return 0;
+}
+
+
+
+// Puts the fitness of a GP into the table
+void GPFitnessTable::insert (GPResultKey& key, double fitness)
+{
+  Entry& e=entry[key.hash & (size-1)];
+  e.hash=key.hash;
+  e.check=key.check;
+  e.fitness=fitness;
+  e.used=1;
+}
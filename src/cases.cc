@@ -0,0 +1,286 @@
+
+// cache.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Evaluation of a GP for many cases at once (see GP::runCases()).
+// The trees are walked once for each block of up to GPCaseBlockSize
+// cases, and each node calculates its results for all cases of the
+// block, so that the cost of walking the trees is shared by the
+// cases.  Subtrees whose results are in the selected GPResultCache
+// are not walked at all.
+
+#include <string.h>
+#include "gp.h"
+
+
+
+// The arguments of nodes with up to this many arguments are kept in
+// local arrays
+const int localArguments=4;
+
+
+
+// What the walk over the trees needs to know about the current block
+struct GPCaseBlock
+{
+  GP* gp;
+  GPAdfNodeSet* adfNs;
+
+  // The context of the first case of the block and the size of the
+  // context of one case
+  char* contexts;
+  int contextSize;
+
+  // The number of cases of the block, and the number of its first
+  // case, which tells the blocks apart in the cache
+  int numCases;
+  int block;
+
+  // The selected cache and the keys of all nodes (both NULL if there
+  // is no cache), and where the keys of each tree start
+  GPResultCache* cache;
+  GPResultKey* keys;
+  int* treeStart;
+};
+
+
+
+// Calculates the results of a gene for the cases of a block and puts
+// them to ret.  args has the results of the arguments of an ADF for
+// each argument.  key points to the key of this gene and is moved
+// behind the keys of its subtree.  The results of functions are
+// cached if they depend on nothing but the contexts of the cases.
+static void runGene (GPCaseBlock& b, GPGene& g, int tree, 
+		     GPResultKey*& key, double** args, double* ret)
+{
+  GPResultKey* k=key ? key++ : NULL;
+  int cacheable=k && g.containerSize () && !k->flags;
+  if (cacheable)
+    {
+      double* v=b.cache->find (k->hash+b.block, k->check);
+      if (v)
+	{
+	  memcpy (ret, v, b.numCases*sizeof (double));
+	  key+=k->length-1;
+	  return;
+	}
+    }
+
+  GPNodeSet& ns=*b.adfNs->NthNodeSet (tree);
+  GPInstruction* i=ns.NthPrimitive (ns.indexOfNode (&g.geneNode ()));
+  if (!i || i->opcode==GPNoPrimitive)
+    GPExitSystem ("GP::runCases", "No primitive for node");
+
+  // The results of the children, one block after the other, and the
+  // arguments of one case
+  int arity=g.containerSize ();
+  double localResults[localArguments*GPCaseBlockSize];
+  double localCase[localArguments];
+  double* a=localResults;
+  double* x=localCase;
+  if (arity>localArguments)
+    {
+      a=new double[arity*GPCaseBlockSize];
+      x=new double[arity];
+    }
+  for (int n=0; n<arity; n++)
+    runGene (b, *g.NthChild (n), tree, key, args, a+n*GPCaseBlockSize);
+
+  switch (i->opcode)
+    {
+    case GPPrimitiveCall:
+      for (int j=0; j<b.numCases; j++)
+	{
+	  for (int n=0; n<arity; n++)
+	    x[n]=a[n*GPCaseBlockSize+j];
+	  ret[j]=i->function (x, b.contexts+j*b.contextSize);
+	}
+      break;
+
+    case GPGeneCall:
+      for (int j=0; j<b.numCases; j++)
+	{
+	  for (int n=0; n<arity; n++)
+	    x[n]=a[n*GPCaseBlockSize+j];
+	  ret[j]=i->function (x, &g);
+	}
+      break;
+
+    case GPArgument:
+      memcpy (ret, args[i->operand], b.numCases*sizeof (double));
+      break;
+
+    case GPAdfCall:
+      {
+#if GPINTERNALCHECK
+	if (i->operand<0 || i->operand>=b.gp->containerSize ()
+	    || !b.gp->NthGene (i->operand))
+	  GPExitSystem ("GP::runCases", 
+			"ADF call of a tree that doesn't exist");
+#endif
+	double* localArgs[localArguments];
+	double** adfArgs=arity>localArguments 
+	  ? new double*[arity] : localArgs;
+	for (int n=0; n<arity; n++)
+	  adfArgs[n]=a+n*GPCaseBlockSize;
+	GPResultKey* adfKey=b.keys ? b.keys+b.treeStart[i->operand] : NULL;
+	runGene (b, *b.gp->NthGene (i->operand), i->operand, adfKey, 
+		 adfArgs, ret);
+	if (adfArgs!=localArgs)
+	  delete [] adfArgs;
+      }
+      break;
+
+    case GPBranch:
+      // Both arguments were calculated, as the node sets are pure
+      for (int j=0; j<b.numCases; j++)
+	ret[j]=i->function (x, b.contexts+j*b.contextSize)!=0.0 
+	  ? a[j] : a[GPCaseBlockSize+j];
+      break;
+
+    default:
+      GPExitSystem ("GP::runCases", "Unknown primitive");
+    }
+
+  if (a!=localResults)
+    {
+      delete [] a;
+      delete [] x;
+    }
+
+  if (cacheable)
+    memcpy (b.cache->insert (k->hash+b.block, k->check), ret, 
+	    b.numCases*sizeof (double));
+}
+
+
+
+// The task of running the blocks of cases
+class GPCaseTask : public GPTask
+{
+public:
+  GPCaseTask (GPCaseBlock& b_, char* contexts_, int numCases_, 
+	      double* results_) : b(b_) { contexts=contexts_; 
+    numCases=numCases_; results=results_; }
+  virtual void run (int n);
+
+private:
+  GPCaseBlock& b;
+  char* contexts;
+  int numCases;
+  double* results;
+};
+
+void GPCaseTask::run (int n)
+{
+  GPCaseBlock block=b;
+  block.block=n*GPCaseBlockSize;
+  block.contexts=contexts+block.block*b.contextSize;
+  block.numCases=numCases-block.block<GPCaseBlockSize 
+    ? numCases-block.block : GPCaseBlockSize;
+  GPResultKey* key=block.keys;
+  runGene (block, *block.gp->NthGene (0), 0, key, NULL, 
+	   results+block.block);
+}
+
+
+
+// Runs the main tree for numCases cases and puts the results to
+// results.  The contexts of the cases are stored one after the other,
+// each contextSize bytes long.  If all node sets are pure (see
+// GPNodeSet::setPure()), the trees are walked once for each block of
+// up to GPCaseBlockSize cases, and the selected GPResultCache is
+// used, if there is one.  As the results are cached for the number of
+// the first case of a block, the contexts must be the same every time
+// the cache is used.  On a thread pool, the blocks are run by the
+// threads that have nothing else to do (see GPThreadPool::fork()).
+// Otherwise (and for GPs that don't keep their trees in the
+// container, like GPFlat) the compiled code is run for each case.
+void GP::runCases (GPAdfNodeSet& adfNs, int numCases, char* contexts, 
+		   int contextSize, double* results)
+{
+  if (!adfNs.isPure () || containerSize ()<adfNs.containerSize () 
+      || !NthGene (0))
+    {
+      GPCode& c=compile (adfNs);
+      for (int j=0; j<numCases; j++)
+	results[j]=c.run (0, NULL, contexts+j*contextSize);
+      return;
+    }
+
+  GPCaseBlock b;
+  b.gp=this;
+  b.adfNs=&adfNs;
+  b.contextSize=contextSize;
+  b.cache=GPResultCache::selected ();
+  if (b.cache && b.cache->valuesPerEntry ()<GPCaseBlockSize)
+    b.cache=NULL;
+  b.keys=NULL;
+  b.treeStart=NULL;
+
+  if (b.cache)
+    {
+      int numTrees=containerSize ();
+      b.treeStart=new int[numTrees];
+      int keyLength=0;
+      for (int n=0; n<numTrees; n++)
+	{
+	  b.treeStart[n]=keyLength;
+	  if (NthGene (n))
+	    keyLength+=NthGene (n)->length ();
+	}
+      b.keys=new GPResultKey[keyLength];
+      GPResultCache::subtreeKeys (*this, adfNs, b.keys);
+    }
+
+  // The blocks are sub-tasks that the other threads of the pool can
+  // take on, if the GP is evaluated on a pool
+  GPCaseTask task (b, contexts, numCases, results);
+  GPThreadPool::fork (task, (numCases+GPCaseBlockSize-1)/GPCaseBlockSize);
+
+  if (b.cache)
+    {
+      delete [] b.keys;
+      delete [] b.treeStart;
+    }
+}
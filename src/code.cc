@@ -0,0 +1,417 @@
+
+// code.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Compiled evaluation of genetic programs.  The user registers the
+// primitives of the nodes with the node sets, and each GP is
+// translated into a linear sequence of instructions in postfix order.
+// A tight loop interprets them using an explicit stack, so that
+// evaluation needs neither recursion nor virtual function calls per
+// node.  Branch nodes are compiled into conditional jumps.  With
+// GPTHREADEDCODE, the interpreter is direct-threaded: each
+// instruction carries the address of its handler, so the dispatch is
+// a single indirect jump at the end of every handler.
+
+#include <string.h>
+#include "gp.h"
+
+
+
+// Stacks up to this size are kept in a local array by GPCode::run()
+const int localStackSize=64;
+
+
+
+// Returns the primitive of the node with the given value.  The table
+// is allocated on first use.
+GPInstruction& GPNodeSet::newPrimitive (int value)
+{
+  if (shareCount)
+    GPExitSystem ("GPNodeSet::newPrimitive", 
+		  "Node set is shared and can't be changed");
+
+  GPNode* node=searchForNode (value);
+  if (!node)
+    GPExitSystem ("GPNodeSet::newPrimitive", "Node not in node set");
+
+  if (!primitive)
+    {
+      primitive=new GPInstruction[containerSize ()];
+      for (int n=0; n<containerSize (); n++)
+	{
+	  primitive[n].handler=NULL;
+	  primitive[n].function=NULL;
+	  primitive[n].data=NULL;
+	  primitive[n].opcode=GPNoPrimitive;
+	  primitive[n].arity=0;
+	}
+    }
+
+  GPInstruction& i=primitive[indexOfNode (node)];
+  i.arity=(short) node->arguments ();
+  return i;
+}
+
+
+
+void GPNodeSet::setPrimitive (int value, GPPrimitive f)
+{
+  GPInstruction& i=newPrimitive (value);
+  i.opcode=GPPrimitiveCall;
+  i.function=f;
+}
+
+
+
+void GPNodeSet::setAdfCall (int value, int tree)
+{
+  GPInstruction& i=newPrimitive (value);
+  i.opcode=GPAdfCall;
+  i.operand=tree;
+}
+
+
+
+void GPNodeSet::setArgument (int value, int argNumber)
+{
+  GPInstruction& i=newPrimitive (value);
+  if (i.arity)
+    GPExitSystem ("GPNodeSet::setArgument", 
+		  "An argument must be a terminal");
+  i.opcode=GPArgument;
+  i.operand=argNumber;
+}
+
+
+
+void GPNodeSet::setGenePrimitive (int value, GPPrimitive f)
+{
+  GPInstruction& i=newPrimitive (value);
+  i.opcode=GPGeneCall;
+  i.function=f;
+}
+
+
+
+void GPNodeSet::setBranch (int value, GPPrimitive condition)
+{
+  GPInstruction& i=newPrimitive (value);
+  if (i.arity!=2)
+    GPExitSystem ("GPNodeSet::setBranch", 
+		  "A branch must have two arguments");
+  i.opcode=GPBranch;
+  i.function=condition;
+}
+
+
+
+// The code is allocated for the given number of instructions (the
+// length of the GP, usually), and enlarged if necessary.
+GPCode::GPCode (int trees, int size)
+{
+  numTrees=trees;
+  treeStart=new int[2*numTrees];
+  maxStack=treeStart+numTrees;
+  for (int n=0; n<2*numTrees; n++)
+    treeStart[n]=0;
+  codeSize=size+numTrees>0 ? size+numTrees : 1;
+  code=new GPInstruction[codeSize];
+  length=0;
+  currentTree=-1;
+  threaded=0;
+}
+
+
+
+GPCode::~GPCode ()
+{
+  delete [] code;
+  delete [] treeStart;
+}
+
+
+
+void GPCode::startTree (int tree)
+{
+  currentTree=tree;
+  treeStart[tree]=length;
+  stackDepth=0;
+}
+
+
+
+GPInstruction& GPCode::append ()
+{
+  if (length==codeSize)
+    {
+      GPInstruction* tmp=new GPInstruction[codeSize*2];
+      memcpy (tmp, code, codeSize*sizeof (GPInstruction));
+      delete [] code;
+      code=tmp;
+      codeSize*=2;
+    }
+  return code[length++];
+}
+
+
+
+// Appends the primitive of a node.  The nodes of a tree must be
+// emitted in postfix order (children first).  The maximum stack
+// depth of the tree is calculated on the way.
+void GPCode::emit (GPNodeSet& ns, int nodeIndex, void* data)
+{
+  GPInstruction* i=ns.NthPrimitive (nodeIndex);
+  if (!i || i->opcode==GPNoPrimitive)
+    GPExitSystem ("GPCode::emit", "No primitive for node");
+  if (i->opcode==GPBranch)
+    GPExitSystem ("GPCode::emit", "Branches need startBranch()");
+#if GPINTERNALCHECK
+  if (i->opcode==GPAdfCall && (i->operand<0 || i->operand>=numTrees))
+    GPExitSystem ("GPCode::emit", "ADF call of a tree that doesn't exist");
+  if (stackDepth<i->arity)
+    GPExitSystem ("GPCode::emit", "Nodes not in postfix order");
+#endif
+
+  if (i->opcode==GPGeneCall && !data)
+    GPExitSystem ("GPCode::emit", "Gene primitive without a gene");
+
+  GPInstruction& c=append ();
+  c=*i;
+  if (c.opcode==GPGeneCall)
+    c.data=data;
+
+  stackDepth+=1-i->arity;
+  if (stackDepth>maxStack[currentTree])
+    maxStack[currentTree]=stackDepth;
+}
+
+
+
+// A branch is a conditional jump to the second argument, which is
+// set by elseBranch().  The first argument ends with a jump behind
+// the second one, set by endBranch().  Both leave one value on the
+// stack, so the depth is set back before the second one.
+int GPCode::startBranch (GPNodeSet& ns, int nodeIndex)
+{
+  GPInstruction* i=ns.NthPrimitive (nodeIndex);
+  if (!i || i->opcode!=GPBranch)
+    GPExitSystem ("GPCode::startBranch", "Node is no branch");
+
+  GPInstruction& c=append ();
+  c=*i;
+  return length-1;
+}
+
+
+
+int GPCode::elseBranch (int branch)
+{
+  GPInstruction& c=append ();
+  c.handler=NULL;
+  c.function=NULL;
+  c.opcode=GPJump;
+  c.arity=0;
+  code[branch].operand=length;
+  stackDepth--;
+  return length-1;
+}
+
+
+
+void GPCode::endBranch (int jump)
+{
+  code[jump].operand=length;
+}
+
+
+
+void GPCode::endTree ()
+{
+#if GPINTERNALCHECK
+  if (length>treeStart[currentTree] && stackDepth!=1)
+    GPExitSystem ("GPCode::endTree", "Tree is incomplete");
+#endif
+  GPInstruction& c=append ();
+  c.handler=NULL;
+  c.function=NULL;
+  c.opcode=GPReturn;
+  c.arity=0;
+  c.operand=0;
+  currentTree=-1;
+}
+
+
+
+// The interpreter.  The arguments of an instruction are on top of the
+// stack, the first one deepest; they are replaced by the result.  The
+// handlers are the same for both kinds of dispatch; with
+// GPTHREADEDCODE, the opcodes are replaced by the addresses of their
+// handlers on the first run.
+#if GPTHREADEDCODE
+#define INSTRUCTION(label, opcode) label:
+#define DISPATCH goto *ip->handler
+#else
+#define INSTRUCTION(label, opcode) case opcode:
+#define DISPATCH continue
+#endif
+
+double GPCode::run (int tree, double* args, void* context)
+{
+  double localStack[localStackSize];
+  double* stack=localStack;
+  if (maxStack[tree]>localStackSize)
+    stack=new double[maxStack[tree]];
+
+  double* sp=stack;
+  GPInstruction* ip=code+treeStart[tree];
+
+#if GPTHREADEDCODE
+  static const void* handler[]={ &&noPrimitive, &&primitiveCall, 
+				 &&adfCall, &&argument, &&geneCall, 
+				 &&branch, &&jump, &&ret };
+  if (!threaded)
+    {
+      for (int n=0; n<length; n++)
+	code[n].handler=handler[code[n].opcode];
+      threaded=1;
+    }
+  DISPATCH;
+#else
+  for (;;)
+    switch (ip->opcode)
+      {
+#endif
+
+  INSTRUCTION (primitiveCall, GPPrimitiveCall)
+    sp-=ip->arity;
+    *sp=ip->function (sp, context);
+    sp++;
+    ip++;
+    DISPATCH;
+
+  INSTRUCTION (adfCall, GPAdfCall)
+    sp-=ip->arity;
+    *sp=run (ip->operand, sp, context);
+    sp++;
+    ip++;
+    DISPATCH;
+
+  INSTRUCTION (argument, GPArgument)
+    *sp++=args[ip->operand];
+    ip++;
+    DISPATCH;
+
+  INSTRUCTION (geneCall, GPGeneCall)
+    sp-=ip->arity;
+    *sp=ip->function (sp, ip->data);
+    sp++;
+    ip++;
+    DISPATCH;
+
+  INSTRUCTION (branch, GPBranch)
+    if (ip->function (sp, context)!=0.0)
+      ip++;
+    else
+      ip=code+ip->operand;
+    DISPATCH;
+
+  INSTRUCTION (jump, GPJump)
+    ip=code+ip->operand;
+    DISPATCH;
+
+  INSTRUCTION (noPrimitive, GPNoPrimitive)
+  INSTRUCTION (ret, GPReturn)
+    goto done;
+
+#if !GPTHREADEDCODE
+      }
+#endif
+
+ done:
+  double result=stack[0];
+  if (stack!=localStack)
+    delete [] stack;
+  return result;
+}
+
+#undef INSTRUCTION
+#undef DISPATCH
+
+
+
+// Emits the genes of a tree in postfix order, and branches with
+// their jumps
+static void emitGene (GPCode& c, GPGene& g, GPNodeSet& ns)
+{
+  int ix=ns.indexOfNode (&g.geneNode ());
+  GPInstruction* i=ns.NthPrimitive (ix);
+  if (i && i->opcode==GPBranch)
+    {
+      int branch=c.startBranch (ns, ix);
+      emitGene (c, *g.NthChild (0), ns);
+      int jump=c.elseBranch (branch);
+      emitGene (c, *g.NthChild (1), ns);
+      c.endBranch (jump);
+      return;
+    }
+
+  for (int n=0; n<g.containerSize (); n++)
+    emitGene (c, *g.NthChild (n), ns);
+  c.emit (ns, ix, &g);
+}
+
+
+
+// Compile the trees of a GP
+GPCode* GP::createCode (GPAdfNodeSet& adfNs)
+{
+  GPCode* c=new GPCode (containerSize (), length ());
+  for (int n=0; n<containerSize (); n++)
+    {
+      c->startTree (n);
+      if (NthGene (n))
+	emitGene (*c, *NthGene (n), *adfNs.NthNodeSet (n));
+      c->endTree ();
+    }
+  return c;
+}
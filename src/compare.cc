@@ -135,3 +135,50 @@ int GPGene::compare (GPGene &g)
 }
 
 
+
+
+
+// Calculates the key of a gene from the address of its node and the
+// keys of its children (see GPResultCache::subtreeKeys(), which does
+// the same for all subtrees of a GP).  Genes that carry a value have
+// to add it, see GP::structureKey().
+GPResultKey GPGene::structureKey ()
+{
+  GPResultKey key;
+  unsigned long nodeAddress=(unsigned long) &geneNode ();
+  key.hash=GPMixHash (nodeAddress);
+  key.check=GPMixHash (nodeAddress*0x9e3779b97f4a7c15UL
+		       +0x632be59bd9b4e019UL);
+  key.length=1;
+  key.flags=0;
+  for (int n=0; n<containerSize(); n++)
+    {
+      GPResultKey child=NthChild (n)->structureKey ();
+      GPAddKey (key, child);
+      key.length+=child.length;
+    }
+  return key;
+}
+
+
+
+// The key of the whole GP (for GPFitnessTable): GPs that are the same
+// for compare() have the same key.  The keys of the trees are added
+// one after the other, an empty tree as an empty key.
+GPResultKey GP::structureKey ()
+{
+  GPResultKey key;
+  key.hash=GPMixHash (containerSize ());
+  key.check=GPMixHash (~(unsigned long) containerSize ());
+  key.length=0;
+  key.flags=0;
+  for (int n=0; n<containerSize(); n++)
+    {
+      GPResultKey tree={0, 0, 0, 0};
+      if (NthGene (n))
+	tree=NthGene (n)->structureKey ();
+      GPAddKey (key, tree);
+      key.length+=tree.length;
+    }
+  return key;
+}
@@ -116,8 +116,12 @@ void GPContainer::deleteContainer ()
 	  // is destroyed here
 	  delete container[i];
 
-      // Delete array of pointer to members
-      delete [] container;
+      // Delete array of pointer to members, unless it is stored
+      // within the object
+#if GPCONTAINERINLINESIZE>0
+      if (container!=inlineContainer)
+#endif
+	GPFree (container);
 
       // Set initial conditions
       container=NULL;
@@ -146,8 +150,15 @@ void GPContainer::reserveSpace (int numObjects)
   // Save the container size in object
   contSize=numObjects;
 
-  // Alloc array of pointers and set them to NULL
-  container=new GPObject*[numObjects];
+  // Alloc array of pointers and set them to NULL.  Small arrays are
+  // kept within the object.  If an arena is selected, larger ones are
+  // allocated from there
+#if GPCONTAINERINLINESIZE>0
+  if (numObjects<=GPCONTAINERINLINESIZE)
+    container=inlineContainer;
+  else
+#endif
+    container=(GPObject**) GPAllocate (numObjects*sizeof (GPObject*));
   for (int i=0; i<numObjects; i++)
     container[i]=NULL;
 }
@@ -169,22 +180,6 @@ void GPContainer::printOn (ostream& os)
 
 
 
-// Gets the n-th object from the container.  This function might
-// return NULL, if there is no object at that location.
-GPObject* GPContainer::Nth (int n) const
-{
-#if GPINTERNALCHECK
-  if (!container)
-    GPExitSystem ("GPContainer::Nth", "No container");
-  if (n>=contSize || n<0)
-    GPExitSystem ("GPContainer::Nth", "Wrong range for index n");
-#endif
-
-  return container[n];
-}
-
-
-
 // Return the adress of the pointer to the n-th Object within the
 // container.  This is usefule for crossover, as only pointers are
 // swapped to exchange complete subtrees
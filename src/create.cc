@@ -77,13 +77,62 @@ void GPPopulation::create ()
   int treedepth=2; 
   GP* newObj;
 
+  // If wanted, the members are allocated from an arena.  Not so for
+  // steady state, where members are replaced one by one: the arena
+  // would grow forever.  Shared subtrees can't be given back as a
+  // whole with the generation they were created in.
+#if GPSHARESUBTREES
+  if (GPVar.ArenaAllocation)
+    GPExitSystem ("GPPopulation::create", "ArenaAllocation can't be "\
+		  "used if GPSHARESUBTREES is set");
+#endif
+  if (GPVar.ArenaAllocation && !GPVar.SteadyState && !arena)
+    arena=new GPArena;
+
+  // If hash consing is wanted, the genes of the population are put
+  // into a table
+#if !GPSHARESUBTREES
+  if (GPVar.HashConsing)
+    GPExitSystem ("GPPopulation::create", "HashConsing needs "\
+		  "GPSHARESUBTREES");
+#endif
+  if (GPVar.HashConsing && !geneTable)
+    geneTable=new GPGeneTable;
+
+  // If the population doesn't fit into memory, each deme is written to
+  // the store as soon as it is complete
+  if (GPVar.OutOfCore)
+    {
+      if (!GPVar.DemeticGrouping || GPVar.SteadyState)
+	GPExitSystem ("GPPopulation::create", "OutOfCore needs "\
+		      "DemeticGrouping and can't be used with SteadyState");
+      if (GPVar.ArenaAllocation || GPVar.HashConsing)
+	GPExitSystem ("GPPopulation::create", "OutOfCore can't be used "\
+		      "with ArenaAllocation or HashConsing");
+      if (GPVar.DemeSize<1 || GPVar.PopulationSize%GPVar.DemeSize!=0)
+	GPExitSystem ("GPPopulation::create", "Wrong deme size: "\
+		      "doesn't fit");
+      if (!store)
+	store=new GPDemeStore;
+    }
+  GPArena* previousArena=GPArena::select (arena);
+
   // At this point, the population container is still empty.  Space
   // must be reserved for all the genetic programs.
   reserveSpace (GPVar.PopulationSize);
 
-  // loop through the whole population
+  // loop through the whole population.  Each member is created with
+  // a random stream of its own.
   for (int i=0; i<containerSize (); i++)
     {
+      GPRandomGenerator* stream=randomStream (i, GPRandomCreation);
+      GPRandomGenerator* previousStream=GPRandomGenerator::select (stream);
+
+      // The members of the former demes have been paged out and are
+      // not checked for diversity any more
+      if (store && i%GPVar.DemeSize==0)
+	creationStartIx=i;
+
       // set up done boolean checks whether we have been around the
       // next do ..while loop
       int Done = 0;
@@ -150,14 +199,31 @@ void GPPopulation::create ()
       // proper GP.
       while (!checkForValidCreation (*newObj) && Done < creationAttempts);
 
+      // Replace the subtrees of the new GP by the ones in the table
+      if (geneTable)
+	geneTable->insert (*newObj);
+
       // Now increase treedepth
       if (++treedepth>GPVar.MaximumDepthForCreation) 
 	treedepth=minTreeDepth;
+
+      // Evaluate a complete deme and write it to the store
+      if (store && (i+1)%GPVar.DemeSize==0)
+	{
+	  evaluateMembers (i+1-GPVar.DemeSize, i+1);
+	  pageOut (i/GPVar.DemeSize, 1);
+	}
+
+      GPRandomGenerator::select (previousStream);
+      delete stream;
     }
+  GPArena::select (previousArena);
+  creationStartIx=0;
 
   // Evaluate each member of the population.  This must be done
   // anyway, so why not here?
-  evaluate ();
+  if (!store)
+    evaluate ();
 
   // Calculate statistics of the new generation
   calculateStatistics ();
@@ -167,10 +233,12 @@ void GPPopulation::create ()
 
 // Compares each member of the population with a GP up to that member
 // of the population.  Used by checkForValidCreation().  Returns 0, if
-// two equal members are found
+// two equal members are found.  If the population is kept in a store
+// (GPVariables parameter OutOfCore), only the members of the current
+// deme are in memory and compared.
 int GPPopulation::checkForDiversity (GP& gp)
 {
-  for (int n=0; n<containerSize(); n++)
+  for (int n=creationStartIx; n<containerSize(); n++)
     {
       GP* cmp=NthGP (n);
 
@@ -263,6 +331,7 @@ void GPGene::create (enum GPCreationType ctype, int allowableDepth,
   // offsprings (the function parameters).  Remember: There is already
   // a Gene, namely the object this routine is called for by
   // GP::create(), and it is a function.
+  int choices[GPCreationBatchSize];
   for (int n=0; n<containerSize(); n++)
     {
       // Now decide whether the offspring should be a function or a
@@ -272,8 +341,16 @@ void GPGene::create (enum GPCreationType ctype, int allowableDepth,
       if (ctype==GPGrow) 
 	chooseTerm=0;
       else 
-	// 50/50% chance of getting a function or a terminal
-	chooseTerm=GPrand () % 2;
+	{
+	  // 50/50% chance of getting a function or a terminal.  The
+	  // choices for several arguments are drawn at once.
+	  if (n%GPCreationBatchSize==0)
+	    GPRandomIndices (choices, 
+			     containerSize()-n<GPCreationBatchSize 
+			     ? containerSize()-n : GPCreationBatchSize,
+			     0, 2);
+	  chooseTerm=choices[n%GPCreationBatchSize];
+	}
       if (allowableDepth<=1)
 	chooseTerm=1;
 
@@ -63,12 +63,14 @@ Fax:    (UK) 061 745 5999
 // of a pointer that refers to the root gene.  We also return the
 // adress of a pointer to the selected gene.  This makes crossover
 // very simple, as only pointers are swapped.  The object this
-// function is called for is of no importance.
-GPGene** GPGene::choose (GPGene** rootPtr)
+// function is called for is of no importance.  If nodeNumber is
+// given, the position of the selected gene is returned there (see
+// updatePath()).
+GPGene** GPGene::choose (GPGene** rootPtr, int* nodeNumber)
 {
   GPGene **pg=NULL;
 
-  // Calculate the length of the subtree starting at the given gene
+  // Get the length of the subtree starting at the given gene
   int totalLength=(**rootPtr).length ();
 
 #if GPINTERNALCHECK
@@ -81,7 +83,9 @@ GPGene** GPGene::choose (GPGene** rootPtr)
   for (int i=0; i<10; i++)
     {
       // Calculate a random number between 1..totalLength
-      int iLengthCount = (GPrand() % totalLength) + 1;
+      int iLengthCount = GPRandomBelow (totalLength) + 1;
+      if (nodeNumber)
+	*nodeNumber=iLengthCount;
 
       // Find gene with this value
       pg=findNthNode (rootPtr, 0, iLengthCount);
@@ -136,7 +140,7 @@ GPContainer& GP::cross (GPContainer* parents,
 #endif
 
   // Work out which adf branch we are going to cut from
-  int randTree=GPrand() % dad.containerSize();
+  int randTree=GPRandomBelow (dad.containerSize());
 
   // Get the adresses of the pointers to the root genes of the ADF
   // branch we are going to cut from
@@ -156,17 +160,27 @@ GPContainer& GP::cross (GPContainer* parents,
     {
       // Determine the cut points by choosing a node within mum and
       // dad
-      GPGene** cutPoint1=(**rootGene1).choose (rootGene1);
-      GPGene** cutPoint2=(**rootGene2).choose (rootGene2);
+      int nodeNumber1, nodeNumber2;
+      GPGene** cutPoint1=(**rootGene1).choose (rootGene1, &nodeNumber1);
+      GPGene** cutPoint2=(**rootGene2).choose (rootGene2, &nodeNumber2);
+#if GPSHARESUBTREES
+      // The parents of the cut points are going to be changed, so
+      // they (and the genes above them) must not be shared
+      cutPoint1=GPGene::unsharePath (rootGene1, nodeNumber1, 0);
+      cutPoint2=GPGene::unsharePath (rootGene2, nodeNumber2, 0);
+#endif
 
       // Swap the whole subtrees.  Easy, isn't it? And so fast...
       GPGene* tmp=*cutPoint1;
       *cutPoint1=*cutPoint2;
       *cutPoint2=tmp;
 
+      // Update length and depth of the genes above the cut points.
       // Here the maximum depth of the new trees and only that trees
       // is calculated as other trees we assume to be under the
       // maximum depth of crossover
+      (**rootGene1).updatePath (nodeNumber1);
+      (**rootGene2).updatePath (nodeNumber2);
       maxDepth1=(**rootGene1).depth ();
       maxDepth2=(**rootGene2).depth ();
 
@@ -177,15 +191,17 @@ GPContainer& GP::cross (GPContainer* parents,
 	  tmp=*cutPoint1;
 	  *cutPoint1=*cutPoint2;
 	  *cutPoint2=tmp;
+	  (**rootGene1).updatePath (nodeNumber1);
+	  (**rootGene2).updatePath (nodeNumber2);
 	}
     }
   while (maxDepth1>maxdepthforcrossover || maxDepth2>maxdepthforcrossover);
 
   // After crossover, the fitness of the GP is no longer valid, so we
-  // set the corresponding flag.  The length and depth has to be
-  // recalculated as well.
-  dad.fitnessValid=0;
-  mum.fitnessValid=0;
+  // set the corresponding flag.  The length and depth of the GPs are
+  // taken from the root genes.
+  dad.invalidateFitness ();
+  mum.invalidateFitness ();
   dad.calcLength();
   dad.calcDepth();
   mum.calcLength();
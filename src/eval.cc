@@ -50,26 +50,238 @@ Fax:    (UK) 061 745 5999
 // It is alsso called after each new generation has been evolved using
 // crossover, creation or reproduction, but only if steady state is
 // not used.  It loops throupgh the population and evaluates the
-// fitness of each genetic program.
+// fitness of each genetic program.  If the population is kept in a
+// store (GPVariables parameter OutOfCore), this is done deme by deme.
 void GPPopulation::evaluate ()
 {
-  // loop through whole population evaluating every GP
-  for (int n=0; n<containerSize(); n++)
+  if (!store)
+    {
+      evaluateMembers (0, containerSize ());
+      return;
+    }
+
+  for (int deme=0; deme<containerSize ()/GPVar.DemeSize; deme++)
+    {
+      int startIx=deme*GPVar.DemeSize;
+      pageIn (deme);
+
+      // Write the deme back only if something has changed
+      int changed=0;
+      for (int n=startIx; n<startIx+GPVar.DemeSize; n++)
+	if (!NthGP (n)->fitnessValid)
+	  changed=1;
+      evaluateMembers (startIx, startIx+GPVar.DemeSize);
+      pageOut (deme, changed);
+    }
+}
+
+
+
+// Evaluates the members startIx..endIx-1 of the population
+void GPPopulation::evaluateMembers (int startIx, int endIx)
+{
+  GP** gps=new GP*[endIx-startIx];
+  int* numbers=new int[endIx-startIx];
+  int numGPs=0;
+  for (int n=startIx; n<endIx; n++)
     {
       GP* current=NthGP (n);
 #if GPINTERNALCHECK
       if (!current)
-	GPExitSystem ("GPPopulation::evaluate", 
+	GPExitSystem ("GPPopulation::evaluateMembers", 
 		      "Member of population is NULL");
 #endif
 
       // If the evaluation is still valid, don't evaluate it again
       if (!current->fitnessValid)
 	{
-	  // Evaluate genetic program
-	  current->evaluate ();
+	  numbers[numGPs]=n;
+	  gps[numGPs++]=current;
+	}
+    }
+
+  evaluateGPs (gps, numbers, numGPs);
+  delete [] gps;
+  delete [] numbers;
+}
+
+
+
+// The task of the thread pool: evaluate the n-th GP with its random
+// stream and measure the time it takes per node
+class GPEvaluationTask : public GPTask
+{
+public:
+  GPEvaluationTask (GP** gps_, GPRandomGenerator** streams_) { 
+    gps=gps_; streams=streams_; }
+  virtual void run (int n);
+
+private:
+  GP** gps;
+  GPRandomGenerator** streams;
+};
+
+void GPEvaluationTask::run (int n)
+{
+  GP& gp=*gps[n];
+  GPRandomGenerator* previous=GPRandomGenerator::select (streams[n]);
+  double start=GPTime ();
+  gp.evaluate ();
+  if (gp.length ()>0)
+    gp.timePerNode=(GPTime ()-start)/gp.length ();
+  GPRandomGenerator::select (previous);
+}
+
+
+
+// The estimated cost of the evaluation of a GP, used to schedule the
+// GPs on the threads of the pool: its length times the time per node
+// measured for it or the GP it was copied from, or, if it was never
+// measured, the average of the population.  Populations whose
+// evaluation costs are not proportional to the length of the GPs
+// override this.
+double GPPopulation::evaluationCost (GP& gp)
+{
+  double time=gp.timePerNode>0.0 ? gp.timePerNode : avgTimePerNode;
+  return time>0.0 ? time*gp.length () : gp.length ();
+}
+
+
+
+// Evaluates a number of GPs, one after the other with evaluateGP(),
+// or on the threads of the pool, if the GPVariables parameter
+// EvaluationThreads is not 1.  Then the fitness table is consulted
+// before and filled after the GPs are evaluated, and no result cache
+// is selected (see GPThreadPool for what the user's evaluate() may
+// do).  The pool gets the estimated cost of each GP.  numbers are
+// the numbers of the GPs in their generation, which choose the
+// random streams they are evaluated with.
+void GPPopulation::evaluateGPs (GP** gps, int* numbers, int numGPs)
+{
+  if (GPVar.EvaluationThreads==1 || numGPs<2)
+    {
+      for (int n=0; n<numGPs; n++)
+	{
+	  GPRandomGenerator* stream=randomStream (numbers[n], 
+						  GPRandomEvaluation);
+	  evaluateGP (*gps[n], *stream);
+	  delete stream;
+	}
+      return;
+    }
+
+  if (!threadPool)
+    threadPool=createThreadPool (GPVar.EvaluationThreads);
+  if (GPVar.FitnessMemo && !fitnessTable)
+    fitnessTable=new GPFitnessTable (GPVar.FitnessMemo);
+
+  // The GPs that are not in the fitness table are evaluated
+  GP** todo=new GP*[numGPs];
+  GPRandomGenerator** streams=new GPRandomGenerator*[numGPs];
+  GPResultKey* keys=fitnessTable ? new GPResultKey[numGPs] : NULL;
+  int numTodo=0;
+  for (int n=0; n<numGPs; n++)
+    {
+      if (fitnessTable)
+	{
+	  keys[numTodo]=gps[n]->structureKey ();
+	  if (fitnessTable->find (keys[numTodo], gps[n]->stdFitness))
+	    {
+	      gps[n]->fitnessValid=1;
+	      continue;
+	    }
+	}
+      streams[numTodo]=randomStream (numbers[n], GPRandomEvaluation);
+      todo[numTodo++]=gps[n];
+    }
+
+  double* cost=new double[numTodo];
+  for (int n=0; n<numTodo; n++)
+    cost[n]=evaluationCost (*todo[n]);
+
+  GPResultCache* previous=GPResultCache::select (NULL);
+  GPEvaluationTask task (todo, streams);
+  threadPool->run (task, numTodo, cost);
+  GPResultCache::select (previous);
+
+  double time=0.0;
+  long length=0;
+  for (int n=0; n<numTodo; n++)
+    {
+      todo[n]->fitnessValid=1;
+      delete streams[n];
+      if (fitnessTable)
+	fitnessTable->insert (keys[n], todo[n]->stdFitness);
+      time+=todo[n]->timePerNode*todo[n]->length ();
+      length+=todo[n]->length ();
+    }
+  if (length>0)
+    avgTimePerNode=time/length;
+  delete [] todo;
+  delete [] streams;
+  delete [] cost;
+  if (keys)
+    delete [] keys;
+}
+
+
 
-	  current->fitnessValid=1;
+// Evaluates a GP and marks its fitness as valid.  If the GPVariables
+// parameter FitnessMemo is set, the fitness is taken from the table
+// if the GP was evaluated before, otherwise it is put into the table.
+// If ResultCacheSize is set and the node sets are pure, the result
+// cache of the population is selected during the evaluation.  An
+// offspring shares most of its subtrees with its parents, whose
+// results are still in the cache, so only the subtrees that were
+// changed by crossover or mutation are calculated again.  GPrand()
+// draws from the given stream during the evaluation.
+void GPPopulation::evaluateGP (GP& gp, GPRandomGenerator& stream)
+{
+  if (GPVar.FitnessMemo && !fitnessTable)
+    fitnessTable=new GPFitnessTable (GPVar.FitnessMemo);
+  if (GPVar.ResultCacheSize && !resultCache && adfNs->isPure ())
+    resultCache=new GPResultCache (GPCaseBlockSize, 
+				   GPVar.ResultCacheSize*1024L);
+  GPResultCache* previous=GPResultCache::select (resultCache);
+  GPRandomGenerator* previousStream=GPRandomGenerator::select (&stream);
+
+  if (fitnessTable)
+    {
+      GPResultKey key=gp.structureKey ();
+      if (!fitnessTable->find (key, gp.stdFitness))
+	{
+	  gp.evaluate ();
+	  fitnessTable->insert (key, gp.stdFitness);
+	}
+    }
+  else
+    gp.evaluate ();
+
+  GPRandomGenerator::select (previousStream);
+  GPResultCache::select (previous);
+  gp.fitnessValid=1;
+}
+
+
+
+// Takes the fitness of the members in the given range that are not
+// evaluated from the fitness table (GPVariables parameter
+// FitnessMemo), if they are in it.  A population that overrides
+// evaluateMembers() and does some work for each member that isn't
+// evaluated (like compiling it) calls this first.
+void GPPopulation::recallFitness (int startIx, int endIx)
+{
+  if (!fitnessTable)
+    return;
+
+  for (int n=startIx; n<endIx; n++)
+    {
+      GP* current=NthGP (n);
+      if (current && !current->fitnessValid)
+	{
+	  GPResultKey key=current->structureKey ();
+	  if (fitnessTable->find (key, current->stdFitness))
+	    current->fitnessValid=1;
 	}
     }
 }
@@ -0,0 +1,822 @@
+
+// flat.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Genetic programs stored as arrays in prefix notation.  The
+// operators do the same as their counterparts of class GP and
+// GPGene, and they even draw the same random numbers, so a GPFlat
+// evolves exactly like a GP if the random generator is seeded
+// equally.  But instead of following and swapping pointers, they
+// copy consecutive ranges of nodes.  The arrays are allocated by
+// GPAllocate(), so they come from the arena of the population, if
+// there is one.
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include "gp.h"
+
+using namespace std;
+
+
+
+// Number of trials to find a function node when choosing a crossover
+// point (see GPGene::choose()) and a node for swap mutation
+const int chooseAttempts=10;
+const int swapAttempts=5;
+
+
+
+// A growing array of nodes.  Used during creation, because we don't
+// know in advance how many nodes a tree will have
+class GPFlatBuffer
+{
+public:
+  GPFlatBuffer () { size=64; length=0; nodes=new GPFlatNode[size]; }
+  ~GPFlatBuffer () { delete [] nodes; }
+
+  int append (int nodeIndex, int args)
+  {
+    if (length==size)
+      {
+	GPFlatNode* tmp=new GPFlatNode[size*2];
+	memcpy (tmp, nodes, size*sizeof (GPFlatNode));
+	delete [] nodes;
+	nodes=tmp;
+	size*=2;
+      }
+    nodes[length].nodeIndex=(unsigned short) nodeIndex;
+    nodes[length].args=(unsigned short) args;
+    nodes[length].subtreeLength=1;
+    return length++;
+  }
+
+  GPFlatNode* nodes;
+  int length;
+
+private:
+  int size;
+};
+
+
+
+// Calculates the depth of the subtree starting at index ix.  The
+// subtree starting at index skip is left out, as if it didn't exist
+// (pass -1 if no subtree is to be left out).  The depth of a terminal
+// is 1.
+static int flatDepth (GPFlatNode* t, int ix, int skip)
+{
+  if (ix==skip)
+    return 0;
+
+  int maxDepthOfChild=0;
+  int child=ix+1;
+  for (int n=0; n<t[ix].args; n++)
+    {
+      int d=flatDepth (t, child, skip);
+      if (d>maxDepthOfChild)
+	maxDepthOfChild=d;
+      child+=t[child].subtreeLength;
+    }
+  return maxDepthOfChild+1;
+}
+
+
+
+// Returns the level of the node with index ix (the root has level
+// 1).  This is the number of subtrees the node belongs to.
+static int flatLevel (GPFlatNode* t, int ix)
+{
+  int level=1;
+  for (int j=0; j<ix; j++)
+    if (j+t[j].subtreeLength>ix)
+      level++;
+  return level;
+}
+
+
+
+// Calculates the subtree lengths of the subtree starting at index ix
+// from the number of arguments.  Returns the index of the first node
+// after the subtree, or -1 if the array is too short.
+static int flatSetLengths (GPFlatNode* t, int ix, int length)
+{
+  if (ix>=length)
+    return -1;
+
+  int next=ix+1;
+  for (int n=0; n<t[ix].args; n++)
+    if ((next=flatSetLengths (t, next, length))<0)
+      return -1;
+  t[ix].subtreeLength=next-ix;
+  return next;
+}
+
+
+
+// Returns a new array that is a copy of tree t1, but the subtree
+// starting at cut1 is replaced by the subtree of t2 starting at cut2.
+// The subtree lengths of all nodes the replaced subtree belongs to
+// are corrected.
+static GPFlatNode* flatSplice (GPFlatTree& t1, int cut1, 
+			       GPFlatTree& t2, int cut2, int& newLength)
+{
+  int len1=t1.nodes[cut1].subtreeLength;
+  int len2=t2.nodes[cut2].subtreeLength;
+  newLength=t1.length-len1+len2;
+
+  GPFlatNode* nodes=
+    (GPFlatNode*) GPAllocate (newLength*sizeof (GPFlatNode));
+  memcpy (nodes, t1.nodes, cut1*sizeof (GPFlatNode));
+  memcpy (nodes+cut1, t2.nodes+cut2, len2*sizeof (GPFlatNode));
+  memcpy (nodes+cut1+len2, t1.nodes+cut1+len1, 
+	  (t1.length-cut1-len1)*sizeof (GPFlatNode));
+
+  for (int j=0; j<cut1; j++)
+    if (j+nodes[j].subtreeLength>cut1)
+      nodes[j].subtreeLength+=len2-len1;
+
+  return nodes;
+}
+
+
+
+// Constructors
+GPFlat::GPFlat ()
+{
+  adfNs=NULL;
+  numTrees=0;
+  tree=NULL;
+}
+
+GPFlat::GPFlat (int trees)
+{
+  adfNs=NULL;
+  numTrees=trees;
+  tree=(GPFlatTree*) GPAllocate (numTrees*sizeof (GPFlatTree));
+  for (int n=0; n<numTrees; n++)
+    {
+      tree[n].nodes=NULL;
+      tree[n].length=0;
+    }
+}
+
+
+
+// Copy constructor.  Each tree is copied in one go.
+GPFlat::GPFlat (const GPFlat& gpo) : GP(gpo)
+{
+  adfNs=gpo.adfNs;
+  numTrees=gpo.numTrees;
+  tree=(GPFlatTree*) GPAllocate (numTrees*sizeof (GPFlatTree));
+  for (int n=0; n<numTrees; n++)
+    {
+      tree[n].length=gpo.tree[n].length;
+      if (tree[n].length)
+	{
+	  tree[n].nodes=(GPFlatNode*) 
+	    GPAllocate (tree[n].length*sizeof (GPFlatNode));
+	  memcpy (tree[n].nodes, gpo.tree[n].nodes, 
+		  tree[n].length*sizeof (GPFlatNode));
+	}
+      else
+	tree[n].nodes=NULL;
+    }
+}
+
+
+
+// Destructor
+GPFlat::~GPFlat ()
+{
+  deleteTrees ();
+}
+
+
+
+// Delete all trees
+void GPFlat::deleteTrees ()
+{
+  if (tree)
+    {
+      for (int n=0; n<numTrees; n++)
+	GPFree (tree[n].nodes);
+      GPFree (tree);
+      tree=NULL;
+    }
+  numTrees=0;
+}
+
+
+
+// Print a tree the same way GPGene::printOn() does
+void GPFlat::printTree (ostream& os, int n, int ix)
+{
+  GPFlatNode& f=tree[n].nodes[ix];
+  if (f.args)
+    os << "(";
+  if (adfNs)
+    os << NthTreeNode (n, ix);
+  else
+    os << '#' << f.nodeIndex;
+  int child=ix+1;
+  for (int i=0; i<f.args; i++)
+    {
+      os << ' ';
+      printTree (os, n, child);
+      child+=tree[n].nodes[child].subtreeLength;
+    }
+  if (f.args)
+    os << ")";
+}
+
+
+
+// Print the main program and all ADF's
+void GPFlat::printOn (ostream& os)
+{
+  for (int n=0; n<numTrees; n++)
+    {
+      if (n==0)
+	os << "GP: ";
+      else
+	os << "ADF" << n-1 << ": ";
+      if (tree[n].length)
+	printTree (os, n, 0);
+      else
+	os << " NONE";
+      os << endl;
+    }
+}
+
+
+
+// The length is the sum of the lengths of all trees
+void GPFlat::calcLength ()
+{
+  int len=0;
+  for (int n=0; n<numTrees; n++)
+    len+=tree[n].length;
+  GPlength=len;
+}
+
+
+
+// The depth is the maximum depth of all trees
+void GPFlat::calcDepth ()
+{
+  int maxDepthAll=0;
+  for (int n=0; n<numTrees; n++)
+    if (tree[n].length)
+      {
+	int d=flatDepth (tree[n].nodes, 0, -1);
+	if (d>maxDepthAll)
+	  maxDepthAll=d;
+      }
+  GPdepth=maxDepthAll;
+}
+
+
+
+// Compare two GPs.  Returns 0 if they are equal, otherwise 1.  As
+// the trees are stored in prefix order, two trees are equal if and
+// only if their arrays are.
+int GPFlat::compare (GP& gp)
+{
+  GPFlat& g=(GPFlat&) gp;
+
+#if GPINTERNALCHECK
+  if (g.isA()!=isA())
+    GPExitSystem ("GPFlat::compare", "Can't compare GPFlat with GP");
+  if (numTrees!=g.numTrees)
+    GPExitSystem ("GPFlat::compare", "Number of ADFs differ");
+#endif
+
+  for (int n=0; n<numTrees; n++)
+    {
+      if (tree[n].length!=g.tree[n].length)
+	return 1;
+      GPFlatNode* t1=tree[n].nodes;
+      GPFlatNode* t2=g.tree[n].nodes;
+      for (int ix=0; ix<tree[n].length; ix++)
+	if (t1[ix].nodeIndex!=t2[ix].nodeIndex || t1[ix].args!=t2[ix].args)
+	  return 1;
+    }
+
+  // Seem to be the same
+  return 0;
+}
+
+
+
+// The key of the GP, see GP::structureKey().  It is calculated from
+// the node indices and numbers of arguments of the arrays, so it
+// differs from the key of a GP with the same trees.
+GPResultKey GPFlat::structureKey ()
+{
+  GPResultKey key;
+  key.hash=GPMixHash (numTrees);
+  key.check=GPMixHash (~(unsigned long) numTrees);
+  key.length=0;
+  key.flags=0;
+  for (int n=0; n<numTrees; n++)
+    {
+      GPFlatNode* t=tree[n].nodes;
+      for (int ix=0; ix<tree[n].length; ix++)
+	{
+	  unsigned long v=((unsigned long) t[ix].nodeIndex << 16)
+	    | t[ix].args;
+	  GPResultKey node={GPMixHash (v+1), GPMixHash (~v), 1, 0};
+	  GPAddKey (key, node);
+	}
+      GPResultKey end={(unsigned long) tree[n].length, 0, 0, 0};
+      GPAddKey (key, end);
+      key.length+=tree[n].length;
+    }
+  return key;
+}
+
+
+
+// Create the trees.  See GP::create() and GPGene::create(): The
+// nodes are chosen in the same order, but appended to an array
+// rather than being linked to their parents.
+static void flatCreate (GPFlatBuffer& buf, int ix, 
+			enum GPCreationType ctype, int allowableDepth, 
+			GPNodeSet& ns)
+{
+  int args=buf.nodes[ix].args;
+  int choices[GPCreationBatchSize];
+  for (int n=0; n<args; n++)
+    {
+      int chooseTerm;
+      if (ctype==GPGrow) 
+	chooseTerm=0;
+      else 
+	{
+	  if (n%GPCreationBatchSize==0)
+	    GPRandomIndices (choices, args-n<GPCreationBatchSize 
+			     ? args-n : GPCreationBatchSize, 0, 2);
+	  chooseTerm=choices[n%GPCreationBatchSize];
+	}
+      if (allowableDepth<=1)
+	chooseTerm=1;
+
+      GPNode* newNode;
+      if (chooseTerm)
+	newNode=&ns.chooseTerminal();
+      else
+	newNode=&ns.chooseFunction();
+
+      int child=buf.append (ns.indexOfNode (newNode), 
+			    newNode->arguments ());
+      if (!chooseTerm)
+	flatCreate (buf, child, ctype, allowableDepth-1, ns);
+    }
+
+  // All children are appended now
+  buf.nodes[ix].subtreeLength=buf.length-ix;
+}
+
+void GPFlat::create (enum GPCreationType ctype, int allowableDepth, 
+		     GPAdfNodeSet& adfNs_)
+{
+#if GPINTERNALCHECK
+  if (ctype!=GPGrow && ctype!=GPVariable)
+    GPExitSystem ("GPFlat::create",
+		  "Argument ctype must be GPGrow or GPVariable");
+  if (numTrees!=adfNs_.containerSize())
+    GPExitSystem ("GPFlat::create", 
+		  "Number of trees differs from number of node sets");
+#endif
+
+  adfNs=&adfNs_;
+
+  // As the first node is always a function, decrease allowableDepth
+  allowableDepth--;
+
+  for (int n=0; n<numTrees; n++)
+    {
+      GPNodeSet& ns=*adfNs->NthNodeSet (n);
+      GPNode& root=ns.chooseFunction ();
+
+      GPFlatBuffer buf;
+      buf.append (ns.indexOfNode (&root), root.arguments ());
+      flatCreate (buf, 0, ctype, allowableDepth, ns);
+
+      // Copy the buffer into an array of exactly the right size
+      GPFree (tree[n].nodes);
+      tree[n].length=buf.length;
+      tree[n].nodes=(GPFlatNode*) 
+	GPAllocate (buf.length*sizeof (GPFlatNode));
+      memcpy (tree[n].nodes, buf.nodes, buf.length*sizeof (GPFlatNode));
+    }
+
+  calcLength ();
+  calcDepth ();
+}
+
+
+
+// Choose a crossover point in tree n, see GPGene::choose().  As the
+// nodes are numbered in the same order as findNthNode() counts them,
+// the n-th node is simply the array element n-1.
+int GPFlat::choose (int n)
+{
+  int totalLength=tree[n].length;
+
+#if GPINTERNALCHECK
+  if (totalLength==0)
+    GPExitSystem ("GPFlat::choose", 
+		  "Tree length is 0: Can't select crossover point");
+#endif
+
+  int ix=0;
+  for (int i=0; i<chooseAttempts; i++)
+    {
+      ix=GPRandomBelow (totalLength);
+      if (tree[n].nodes[ix].args) 
+	return ix;
+    }
+  return ix;
+}
+
+
+
+// Subtree crossover, see GP::cross().  The depth of the offspring is
+// calculated before anything is copied, so nothing has to be undone
+// if the depth would be too high.
+GPContainer& GPFlat::cross (GPContainer* parents, 
+			    int maxdepthforcrossover)
+{
+#if GPINTERNALCHECK
+  if (parents->containerSize()!=2)
+    GPExitSystem ("GPFlat::cross", 
+		  "Only two parents allowed for crossover");
+#endif
+
+  GPFlat& dad=*(GPFlat*)parents->Nth (0);
+  GPFlat& mum=*(GPFlat*)parents->Nth (1);
+
+#if GPINTERNALCHECK
+  if (dad.numTrees!=mum.numTrees)
+    GPExitSystem ("GPFlat::cross", 
+		  "Mum and Dad must have same number of trees");
+  if (dad.numTrees==0)
+    GPExitSystem ("GPFlat::cross", "Parents contain no trees");
+#endif
+
+  int randTree=GPRandomBelow (dad.numTrees);
+  GPFlatTree& t1=dad.tree[randTree];
+  GPFlatTree& t2=mum.tree[randTree];
+
+#if GPINTERNALCHECK
+  if (!t1.length || !t2.length)
+    GPExitSystem ("GPFlat::cross", "Genetic tree of Mum or Dad is empty");
+#endif
+
+  // Find two cut points so that the maximum depth is not exceeded.
+  // The depth of the new tree is the maximum of the depth of the tree
+  // without the cut subtree and the depth of the inserted subtree
+  // plus the level it is inserted at
+  int cut1, cut2, maxDepth1, maxDepth2;
+  do
+    {
+      cut1=dad.choose (randTree);
+      cut2=mum.choose (randTree);
+
+      maxDepth1=flatDepth (t1.nodes, 0, cut1);
+      int d=flatLevel (t1.nodes, cut1)-1+flatDepth (t2.nodes, cut2, -1);
+      if (d>maxDepth1)
+	maxDepth1=d;
+
+      maxDepth2=flatDepth (t2.nodes, 0, cut2);
+      d=flatLevel (t2.nodes, cut2)-1+flatDepth (t1.nodes, cut1, -1);
+      if (d>maxDepth2)
+	maxDepth2=d;
+    }
+  while (maxDepth1>maxdepthforcrossover || maxDepth2>maxdepthforcrossover);
+
+  // Build the new trees and replace the old ones
+  int len1, len2;
+  GPFlatNode* nodes1=flatSplice (t1, cut1, t2, cut2, len1);
+  GPFlatNode* nodes2=flatSplice (t2, cut2, t1, cut1, len2);
+  GPFree (t1.nodes);
+  GPFree (t2.nodes);
+  t1.nodes=nodes1;
+  t1.length=len1;
+  t2.nodes=nodes2;
+  t2.length=len2;
+
+  dad.invalidateFitness ();
+  mum.invalidateFitness ();
+  dad.calcLength();
+  dad.calcDepth();
+  mum.calcLength();
+  mum.calcDepth();
+
+  return *parents;
+}
+
+
+
+// Swap mutation, see GP::swapMutation()
+int GPFlat::swapMutation (GPAdfNodeSet& adfNs_)
+{
+#if GPINTERNALCHECK
+  if (numTrees==0)
+    GPExitSystem ("GPFlat::swapMutation", "GP contains no trees");
+#endif
+
+  int randtree=GPRandomBelow (numTrees);
+  GPNodeSet& ns=*adfNs_.NthNodeSet (randtree);
+  if (tree[randtree].length)
+    {
+      GPFlatNode& f=tree[randtree].nodes[choose (randtree)];
+      int value=ns.NthNode (f.nodeIndex)->value ();
+
+      for (int i=0; i<swapAttempts; i++)
+	{
+	  GPNode* node=ns.chooseNodeWithArgs (f.args);
+	  if (node)
+	    if (node->value() != value)
+	      {
+		f.nodeIndex=(unsigned short) ns.indexOfNode (node);
+		return 1;
+	      }
+	}
+    }
+  return 0;
+}
+
+
+
+// Shrink mutation, see GP::shrinkMutation().  The chosen function
+// node is replaced by one of its subtrees, which means that the
+// subtree and the rest of the tree is moved to lower indices
+int GPFlat::shrinkMutation ()
+{
+#if GPINTERNALCHECK
+  if (numTrees==0)
+    GPExitSystem ("GPFlat::shrinkMutation", "GP contains no trees");
+#endif
+
+  int randtree=GPRandomBelow (numTrees);
+  GPFlatTree& t=tree[randtree];
+  if (!t.length)
+    return 0;
+
+  // Count the function nodes and choose one of them
+  int totalFunctions=0, ix;
+  for (ix=0; ix<t.length; ix++)
+    if (t.nodes[ix].args)
+      totalFunctions++;
+  if (totalFunctions==0)
+    return 0;
+  int randomFunc=GPRandomBelow (totalFunctions) + 1;
+  for (ix=0; ix<t.length; ix++)
+    if (t.nodes[ix].args)
+      if (--randomFunc<=0)
+	break;
+
+  // Choose one subtree (or child) of the chosen function node
+  int subTree=GPRandomBelow (t.nodes[ix].args);
+  int child=ix+1;
+  for (int n=0; n<subTree; n++)
+    child+=t.nodes[child].subtreeLength;
+
+  // Move the child to the place of its parent, and the rest of the
+  // tree behind it
+  int oldLength=t.nodes[ix].subtreeLength;
+  int childLength=t.nodes[child].subtreeLength;
+  int delta=oldLength-childLength;
+  memmove (t.nodes+ix, t.nodes+child, childLength*sizeof (GPFlatNode));
+  memmove (t.nodes+ix+childLength, t.nodes+ix+oldLength,
+	   (t.length-ix-oldLength)*sizeof (GPFlatNode));
+  t.length-=delta;
+
+  // Correct the subtree lengths of the nodes above
+  for (int j=0; j<ix; j++)
+    if (j+t.nodes[j].subtreeLength>ix)
+      t.nodes[j].subtreeLength-=delta;
+
+  calcLength ();
+  calcDepth ();
+  return 1;
+}
+
+
+
+// The node indices refer to the node sets.  Here we check whether
+// they are valid and remember the node sets.
+void GPFlat::resolveNodeValues (GPAdfNodeSet& adfNs_)
+{
+  adfNs=&adfNs_;
+  for (int n=0; n<numTrees; n++)
+    {
+      GPNodeSet& ns=*adfNs->NthNodeSet (n);
+      for (int ix=0; ix<tree[n].length; ix++)
+	{
+	  GPFlatNode& f=tree[n].nodes[ix];
+	  if (f.nodeIndex>=ns.containerSize() || !ns.NthNode (f.nodeIndex))
+	    GPExitSystem ("GPFlat::resolveNodeValues", 
+			  "Node index not in node set");
+	  if (ns.NthNode (f.nodeIndex)->arguments()!=f.args)
+	    GPExitSystem ("GPFlat::resolveNodeValues", 
+			  "Number of arguments differs from node set");
+	}
+    }
+}
+
+
+
+// Load operation.  Only the node index and the number of arguments
+// are saved, the subtree lengths are calculated.
+char* GPFlat::load (istream& is)
+{
+  is >> fitnessValid;
+  is >> stdFitness;
+
+  deleteTrees ();
+  is >> numTrees;
+  tree=(GPFlatTree*) GPAllocate (numTrees*sizeof (GPFlatTree));
+  for (int n=0; n<numTrees; n++)
+    {
+      tree[n].nodes=NULL;
+      tree[n].length=0;
+    }
+
+  for (int n=0; n<numTrees; n++)
+    {
+      int length;
+      is >> length;
+      tree[n].length=length;
+      if (length)
+	{
+	  tree[n].nodes=(GPFlatNode*) 
+	    GPAllocate (length*sizeof (GPFlatNode));
+	  for (int ix=0; ix<length; ix++)
+	    {
+	      int nodeIndex, args;
+	      is >> nodeIndex >> args;
+	      tree[n].nodes[ix].nodeIndex=(unsigned short) nodeIndex;
+	      tree[n].nodes[ix].args=(unsigned short) args;
+	    }
+	  if (flatSetLengths (tree[n].nodes, 0, length)!=length)
+	    return "GPFlat: Tree length and number of arguments don't match";
+	}
+    }
+  if (!is)
+    return "GPFlat: Unexpected end of stream";
+
+  calcLength ();
+  calcDepth ();
+  return NULL;
+}
+
+
+
+// Save operation
+void GPFlat::save (ostream& os)
+{
+  os << fitnessValid << ' ';
+  os << stdFitness << ' ';
+  os << numTrees << ' ';
+  for (int n=0; n<numTrees; n++)
+    {
+      os << "\n" << tree[n].length << ' ';
+      for (int ix=0; ix<tree[n].length; ix++)
+	os << tree[n].nodes[ix].nodeIndex << ' ' 
+	   << tree[n].nodes[ix].args << ' ';
+    }
+}
+
+
+
+// Compact binary form for GPDemeStore.  As for save(), only the node
+// indices are written, the rest is calculated.
+void GPFlat::pack (GPDemeStore& store, GPAdfNodeSet&)
+{
+  for (int n=0; n<numTrees; n++)
+    {
+      store.write (&tree[n].length, sizeof (int));
+      unsigned short* p=(unsigned short*) 
+	store.append (tree[n].length*sizeof (unsigned short));
+      for (int ix=0; ix<tree[n].length; ix++)
+	p[ix]=tree[n].nodes[ix].nodeIndex;
+    }
+}
+
+
+
+void GPFlat::unpack (char*& data, GPAdfNodeSet& adfNs_)
+{
+  adfNs=&adfNs_;
+  for (int n=0; n<numTrees; n++)
+    {
+      int length;
+      memcpy (&length, data, sizeof (int));
+      data+=sizeof (int);
+      GPFree (tree[n].nodes);
+      tree[n].nodes=NULL;
+      tree[n].length=length;
+      if (length)
+	{
+	  GPNodeSet& ns=*adfNs->NthNodeSet (n);
+	  unsigned short* p=(unsigned short*) data;
+	  tree[n].nodes=(GPFlatNode*) 
+	    GPAllocate (length*sizeof (GPFlatNode));
+	  for (int ix=0; ix<length; ix++)
+	    {
+	      tree[n].nodes[ix].nodeIndex=p[ix];
+	      tree[n].nodes[ix].args=
+		(unsigned short) ns.NthNode (p[ix])->arguments ();
+	    }
+	  flatSetLengths (tree[n].nodes, 0, length);
+	  data+=length*sizeof (unsigned short);
+	}
+    }
+
+  calcLength ();
+  calcDepth ();
+}
+
+
+
+// Compile the trees.  The nodes are emitted in postfix order, which
+// is found from the subtree lengths.  There are no genes, so gene
+// primitives can't be used.
+static void emitFlat (GPCode& c, GPFlatNode* t, int ix, GPNodeSet& ns)
+{
+  GPInstruction* i=ns.NthPrimitive (t[ix].nodeIndex);
+  if (i && i->opcode==GPBranch)
+    {
+      int branch=c.startBranch (ns, t[ix].nodeIndex);
+      emitFlat (c, t, ix+1, ns);
+      int jump=c.elseBranch (branch);
+      emitFlat (c, t, ix+1+t[ix+1].subtreeLength, ns);
+      c.endBranch (jump);
+      return;
+    }
+
+  int child=ix+1;
+  for (int n=0; n<t[ix].args; n++)
+    {
+      emitFlat (c, t, child, ns);
+      child+=t[child].subtreeLength;
+    }
+  c.emit (ns, t[ix].nodeIndex);
+}
+
+GPCode* GPFlat::createCode (GPAdfNodeSet& adfNs_)
+{
+  GPCode* c=new GPCode (numTrees, length ());
+  for (int n=0; n<numTrees; n++)
+    {
+      c->startTree (n);
+      if (tree[n].length)
+	emitFlat (*c, tree[n].nodes, 0, *adfNs_.NthNodeSet (n));
+      c->endTree ();
+    }
+  return c;
+}
@@ -54,6 +54,48 @@ Fax:    (UK) 061 745 5999
 
 
 
+// Copy constructor.  If subtrees are shared, the children are not
+// copied, but referenced by both genes
+#if GPSHARESUBTREES
+GPGene::GPGene (const GPGene& gpo) : GPContainer (gpo.containerSize ())
+{
+  for (int n=0; n<containerSize(); n++)
+    if (gpo.container[n])
+      container[n]=((GPGene*) gpo.container[n])->share ();
+#else
+GPGene::GPGene (const GPGene& gpo) : GPContainer (gpo)
+{
+#endif
+  node=gpo.node;
+  subtreeLength=gpo.subtreeLength;
+  subtreeDepth=gpo.subtreeDepth;
+  shareCount=0;
+}
+
+
+
+// Destructor.  Shared children are only given back, the container
+// deletes the others.
+GPGene::~GPGene ()
+{
+#if GPINTERNALCHECK
+  if (shareCount)
+    GPExitSystem ("GPGene::~GPGene", "Gene is still shared");
+#endif
+
+#if GPSHARESUBTREES
+  GPGene* current;
+  for (int n=0; n<containerSize(); n++)
+    if ((current=NthChild (n)))
+      {
+	release (current);
+	container[n]=NULL;
+      }
+#endif
+}
+
+
+
 // Print function
 void GPGene::printOn (ostream& os)
 {
@@ -80,41 +122,146 @@ void GPGene::printOn (ostream& os)
 
 
 // Calculates the length of a genetic program or subtree (count all
-// nodes) from this point on
+// nodes) from this point on.  The length is calculated only once and
+// then kept in the gene
 int GPGene::length ()
 {
-  int lengthSoFar=1;   // Thats me!
+  if (!subtreeLength)
+    {
+      int lengthSoFar=1;   // Thats me!
 
-  // Do same for all children, if there are any, and add up length
-  GPGene* current;
-  for (int n=0; n<containerSize(); n++)
-    if ((current=NthChild (n)))
-      lengthSoFar+=current->length ();
+      // Do same for all children, if there are any, and add up length
+      GPGene* current;
+      for (int n=0; n<containerSize(); n++)
+	if ((current=NthChild (n)))
+	  lengthSoFar+=current->length ();
+
+      subtreeLength=lengthSoFar;
+    }
 
   // Return the length
-  return lengthSoFar;
+  return subtreeLength;
 }
 
 
 
 // Calculates the depth of a genetic program or subtree from this
 // point on.  Please call from outside without parameters as the
-// default value of the parameter is meaningful!
+// default value of the parameter is meaningful!  As the length, the
+// depth of the subtree is calculated only once and then kept in the
+// gene.
 int GPGene::depth (int depthSoFar)
 {
-  // Calc depth for all children.  If it turns out to be greater than
-  // depthSoFar, save the value and return it later
+  if (!subtreeDepth)
+    {
+      // Calc depth for all children and save the greatest one
+      GPGene* current;
+      int maxDepthOfChild=0;
+      for (int n=0; n<containerSize(); n++)
+	if ((current=NthChild (n)))
+	  {
+	    int d=current->depth ();
+	    if (d>maxDepthOfChild)
+	      maxDepthOfChild=d;
+	  }
+
+      subtreeDepth=maxDepthOfChild+1;
+    }
+
+  return depthSoFar-1+subtreeDepth;
+}
+
+
+
+// Recalculates length and depth of all genes on the path from this
+// gene to the parent of the gene with the given node number (the
+// position of the gene when counting all nodes in prefix order,
+// starting with 1 for this gene).  This function has to be called
+// after the subtree at that position was replaced.  As the position
+// of a gene doesn't depend on what comes after it, the old lengths
+// still kept in the genes on the path lead us to the changed gene.
+// Only the genes on the path are visited, so this costs O(depth)
+// instead of O(length).  The changed gene itself keeps the values of
+// its own subtree.
+void GPGene::updatePath (int nodeNumber)
+{
+  if (--nodeNumber<=0)
+    return;
+
+  // Descend to the child that contains the changed gene
   GPGene* current;
-  int maxDepthOfChild=depthSoFar;
   for (int n=0; n<containerSize(); n++)
     if ((current=NthChild (n)))
       {
-	int d=current->depth (depthSoFar+1);
-	if (d>maxDepthOfChild)
-	  maxDepthOfChild=d;
+	int len=current->length ();
+	if (nodeNumber<=len)
+	  {
+	    current->updatePath (nodeNumber);
+	    break;
+	  }
+	nodeNumber-=len;
       }
 
-  return maxDepthOfChild;
+  // Recalculate from the values the children keep
+  subtreeLength=1;
+  subtreeDepth=0;
+  for (int n=0; n<containerSize(); n++)
+    if ((current=NthChild (n)))
+      {
+	subtreeLength+=current->length ();
+	int d=current->depth ();
+	if (d>subtreeDepth)
+	  subtreeDepth=d;
+      }
+  subtreeDepth++;
+}
+
+
+
+// Makes sure that no gene on the path from the root gene to the gene
+// with the given node number (see updatePath()) is shared with other
+// trees, so that it may be changed.  Shared genes are replaced by a
+// copy that references the same children.  The gene itself is only
+// copied if includeGene is set, as crossover and shrink mutation
+// change only the pointer to it.  The root gene is given by the
+// address of the pointer to it, and we return the address of the
+// pointer to the gene, as choose() does.
+GPGene** GPGene::unsharePath (GPGene** rootPtr, int nodeNumber,
+			      int includeGene)
+{
+  GPGene** genePtr=rootPtr;
+  while (nodeNumber>1 || includeGene)
+    {
+      // Replace the gene by a copy of its own
+      GPGene* g=*genePtr;
+      if (g->shareCount)
+	{
+	  *genePtr=(GPGene*) &g->duplicate ();
+	  g->shareCount--;
+	}
+
+      if (--nodeNumber<=0)
+	break;
+
+      // Descend to the child that contains the gene
+      g=*genePtr;
+      for (int n=0; n<g->containerSize(); n++)
+	{
+	  GPGene** childPtr=(GPGene**) g->getPointerAddress (n);
+	  if (*childPtr)
+	    {
+	      int len=(**childPtr).length ();
+	      if (nodeNumber<=len)
+		{
+		  genePtr=childPtr;
+		  break;
+		}
+	      nodeNumber-=len;
+	    }
+	}
+    }
+
+  return genePtr;
 }
 
 
@@ -123,16 +270,52 @@ int GPGene::depth (int depthSoFar)
 // subtree.  This function is useful for crossover and shrink
 // mutation.  The flag findFunction determines whether only function
 // nodes (shrink mutation) are searched or just any node type
-// (crossover).
+// (crossover).  If nodeNumber is given, the number of genes visited
+// is added to it, so that it contains the position of the returned
+// gene in prefix order (this is needed for updatePath()).
 GPGene** GPGene::findNthNode (GPGene** rootPtr, int findFunction,
-			      int &iLengthCount)
+			      int &iLengthCount, int* nodeNumber)
 {
-  // if we are looking for any node, or if we are looking just for
-  // function nodes and this happens to be one, then ...
-  if (!findFunction 
-      || (findFunction && (**rootPtr).containerSize()>0))
+  // If we are looking for any node, the length of the subtrees tells
+  // us which child contains it, and we descend directly to it
+  if (!findFunction)
+    {
+      int len=(**rootPtr).length ();
+      if (iLengthCount>len)
+	{
+	  iLengthCount-=len;
+	  if (nodeNumber)
+	    *nodeNumber+=len;
+	  return NULL;
+	}
+
+      if (nodeNumber)
+	*nodeNumber+=iLengthCount;
+      while (--iLengthCount>0)
+	for (int n=0; n<(**rootPtr).containerSize(); n++)
+	  {
+	    GPGene** childPtr=(GPGene**) (**rootPtr).getPointerAddress (n);
+	    if (*childPtr)
+	      {
+		len=(**childPtr).length ();
+		if (iLengthCount<=len)
+		  {
+		    rootPtr=childPtr;
+		    break;
+		  }
+		iLengthCount-=len;
+	      }
+	  }
+      return rootPtr;
+    }
+
+  if (nodeNumber)
+    (*nodeNumber)++;
+
+  // If this happens to be a function node, decrement the length
+  // counter and return if it is zero
+  if ((**rootPtr).containerSize()>0)
     {
-      // ... decrement the length counter and return if it is zero
       if (--iLengthCount<=0)
 	return rootPtr;
     }
@@ -149,7 +332,7 @@ GPGene** GPGene::findNthNode (GPGene** rootPtr, int findFunction,
 	  // Recursive call for the children
 	  GPGene** found=
 	    (**childPtr).findNthNode (childPtr, findFunction, 
-				      iLengthCount);
+				      iLengthCount, nodeNumber);
 
 	  // If we found it, return immediately
 	  if (found) 
@@ -166,11 +349,20 @@ GPGene** GPGene::findNthNode (GPGene** rootPtr, int findFunction,
 // Resolve the pointers to the nodes
 void GPGene::resolveNodeValues (GPNodeSet& ns)
 {
+#if GPCOMPACTNODES
+  // The node was loaded directly, we only check it
+#if GPINTERNALCHECK
+  if (ns.indexOfNode (node)<0)
+    GPExitSystem ("GPGene::resolveNodeValues", 
+		  "Node not in node set");
+#endif
+#else
   // Transform the node value to an address to the appropriate node
   node=ns.searchForNode (nodeValue);
   if (!node)
     GPExitSystem ("GPGene::resolveNodeValues", 
 		  "Node value not in node set");
+#endif
 
   // Same for all children
   GPGene* current;
@@ -184,9 +376,18 @@ void GPGene::resolveNodeValues (GPNodeSet& ns)
 // Load operation
 char* GPGene::load (istream& is)
 {
+#if GPCOMPACTNODES
+  // Load the index of the node
+  int ix;
+  is >> ix;
+  if (ix<=0 || ix>=GPNode::tableSize () || !GPNode::NthTableNode (ix))
+    return "Node index not in table of nodes";
+  node.setIndex (ix);
+#else
   // We can load only the node's value.  This has to be transformed to
   // a pointer to a node by function resolveNodeValues().
   is >> nodeValue;
+#endif
 
   // Load container
   return GPContainer::load (is);
@@ -197,8 +398,12 @@ char* GPGene::load (istream& is)
 // Save operation
 void GPGene::save (ostream& os)
 {
-  // Save node value
+  // Save node value, or its index
+#if GPCOMPACTNODES
+  os << node.index () << ' ';
+#else
   os << node->value() << ' ';
+#endif
 
   // Save container
   GPContainer::save (os);
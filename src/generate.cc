@@ -116,6 +116,59 @@ void GPPopulation::generate (GPPopulation& newPop)
     GPExitSystem ("GPPopulation::generate", 
 		  "MaximumDepthForCrossover is smaller than "\
 		  "MaximumDepthForCreation");
+#if GPSHARESUBTREES
+  if (GPVar.ArenaAllocation)
+    GPExitSystem ("GPPopulation::generate", "ArenaAllocation can't "\
+		  "be used if GPSHARESUBTREES is set");
+#else
+  if (GPVar.HashConsing)
+    GPExitSystem ("GPPopulation::generate", "HashConsing needs "\
+		  "GPSHARESUBTREES");
+#endif
+  if (GPVar.OutOfCore)
+    {
+      if (!GPVar.DemeticGrouping || GPVar.SteadyState)
+	GPExitSystem ("GPPopulation::generate", "OutOfCore needs "\
+		      "DemeticGrouping and can't be used with SteadyState");
+      if (GPVar.ArenaAllocation || GPVar.HashConsing)
+	GPExitSystem ("GPPopulation::generate", "OutOfCore can't be "\
+		      "used with ArenaAllocation or HashConsing");
+    }
+
+  // If hash consing is used, remove the genes that are no longer part
+  // of any GP from the table (the former generation was deleted in
+  // the meantime).  If there is no table yet (the population might
+  // have been loaded), set it up.
+  if (GPVar.HashConsing)
+    if (geneTable)
+      geneTable->purge ();
+    else
+      {
+	geneTable=new GPGeneTable;
+	for (int n=0; n<containerSize (); n++)
+	  if (NthGP (n))
+	    geneTable->insert (*NthGP (n));
+      }
+
+  // The new generation takes over the fitness table, the result
+  // cache and the threads, as it is evaluated before this generate()
+  // returns
+  if (!GPVar.SteadyState && fitnessTable && !newPop.fitnessTable)
+    {
+      newPop.fitnessTable=fitnessTable;
+      fitnessTable=NULL;
+    }
+  if (!GPVar.SteadyState && resultCache && !newPop.resultCache)
+    {
+      newPop.resultCache=resultCache;
+      resultCache=NULL;
+    }
+  if (!GPVar.SteadyState && threadPool && !newPop.threadPool)
+    {
+      newPop.threadPool=threadPool;
+      newPop.avgTimePerNode=avgTimePerNode;
+      threadPool=NULL;
+    }
 
   // If demetic grouping is used, the population is divided into
   // demes.  We implement it this way: Each deme undergoes the same
@@ -139,8 +192,33 @@ void GPPopulation::generate (GPPopulation& newPop)
   else
     demeSize=containerSize ();
 
+  // The number of the generation that is made now.  Each call of
+  // evolution() draws from a random stream of its own, which belongs
+  // to the deme and the number of the first new member.
+  int generation=generationNumber+1;
+  if (GPVar.SteadyState)
+    generationNumber=generation;
+  else
+    newPop.generationNumber=generation;
+  GPRandomGenerator* previousStream=GPRandomGenerator::selected ();
+
+  GPArena* previousArena=GPArena::selected ();
   if (!GPVar.SteadyState)
     {
+      // Everything that is allocated from now on becomes part of the
+      // new generation, so it is taken from the arena of the new
+      // population, if wanted.  The members of this population are
+      // only copied, never moved into the new one, so this
+      // population can give back its arena as a whole later.
+      if (GPVar.ArenaAllocation && !newPop.arena)
+	newPop.arena=new GPArena;
+      GPArena::select (newPop.arena);
+
+      // The new population is written to a store deme by deme, if it
+      // doesn't fit into memory
+      if (GPVar.OutOfCore && !newPop.store)
+	newPop.store=new GPDemeStore;
+
       // The user has already created a new generation object, but the
       // container should still be empty.  Allocate space for the new
       // population members.
@@ -170,18 +248,33 @@ void GPPopulation::generate (GPPopulation& newPop)
       range.startIx=demeStart;
       range.endIx=demeStart+demeSize;
 
+      // If the population is kept in a store, the deme must be paged
+      // in for selection
+      if (store)
+	pageIn (demeStart/demeSize);
+
       // Continue until the whole deme or population is full.  n is
       // incremented for every new member that comes into the new
       // population
       for (int n=0; n<demeSize; )
 	{
+	  GPRandomGenerator* stream=createRandomStream (generation, 
+							demeStart/demeSize, n,
+							GPRandomBreeding);
+	  GPRandomGenerator::select (stream);
+
 	  // The genetic evolution returns a container with genetic
 	  // programs to be put in the new generation
 	  GPContainer *gpCont=evolution (range);
 
 	  // Steady state programming: To replace bad genetic programs
 	  // of the old population, they must be selected first.
+	  // The new members are evaluated together and replace them
+	  // afterwards.
 	  int* selectBadGPs=NULL;
+	  GP** offspring=NULL;
+	  int* numbers=NULL;
+	  int numOffspring=0;
 	  if (GPVar.SteadyState)
 	    // Are there members in the container at all?
 	    if (gpCont->containerSize ())
@@ -189,6 +282,8 @@ void GPPopulation::generate (GPPopulation& newPop)
 		int numToSelect=gpCont->containerSize ();
 		selectBadGPs=new int [numToSelect];
 		selectIndices (selectBadGPs, numToSelect, 1, range);
+		offspring=new GP* [numToSelect];
+		numbers=new int [numToSelect];
 	      }
 
 	  // Now we have a container with all the GPs that become
@@ -232,19 +327,21 @@ void GPPopulation::generate (GPPopulation& newPop)
 		      // be full (in short: it's faster).
 		      newGP.mutate (GPVar, *adfNs);
 
-		      // If SteadyState is used, evaluate the GP, then
-		      // replace some bad genetic program selected
-		      // before, otherwise put the object into the new
-		      // population
+		      // Put the genes crossover and mutation have
+		      // created into the table
+		      if (geneTable)
+			geneTable->insert (newGP);
+
+		      // If SteadyState is used, the GP replaces the
+		      // bad genetic program selected before, once it
+		      // is evaluated, otherwise put the object into
+		      // the new population
 		      if (GPVar.SteadyState)
 			{
-			  // Is the fitness still valid?
-			  if (!newGP.fitnessValid)
-			    {
-			      newGP.evaluate ();
-			      newGP.fitnessValid=1;
-			    }
-			  put (selectBadGPs[j], newGP);
+			  // The indices move to the front with the GPs
+			  selectBadGPs[numOffspring]=selectBadGPs[j];
+			  numbers[numOffspring]=demeStart+n;
+			  offspring[numOffspring++]=&newGP;
 			}
 		      else
 			newPop.put (demeStart+n, newGP);
@@ -256,17 +353,65 @@ void GPPopulation::generate (GPPopulation& newPop)
 		}
 	    }
 
+	  // Steady state: Evaluate the new GPs whose fitness is not
+	  // valid any more (all at once, so that they can be
+	  // evaluated on several threads), then replace the bad ones.
+	  // The random stream of the evaluation of an offspring belongs
+	  // to its number in the generation, not to the index it
+	  // replaces, which may come up more than once.
+	  if (numOffspring)
+	    {
+	      GP** gps=new GP* [numOffspring];
+	      int numGPs=0;
+	      for (int j=0; j<numOffspring; j++)
+		if (!offspring[j]->fitnessValid)
+		  {
+		    numbers[numGPs]=numbers[j];
+		    gps[numGPs++]=offspring[j];
+		  }
+	      evaluateGPs (gps, numbers, numGPs);
+	      delete [] gps;
+	      for (int j=0; j<numOffspring; j++)
+		put (selectBadGPs[j], *offspring[j]);
+	    }
+
 	  // Delete container and all objects that are still left in
-	  // it, and the array of indices used for steady state
-	  // programming
+	  // it, and the arrays used for steady state programming
 	  delete gpCont;
 	  if (selectBadGPs)
 	    delete [] selectBadGPs;
+	  if (offspring)
+	    delete [] offspring;
+	  if (numbers)
+	    delete [] numbers;
+	  GPRandomGenerator::select (previousStream);
+	  delete stream;
 	}
+
+      // Only one deme of each population is kept in memory: the new
+      // deme is evaluated and written to the store, the old one is
+      // dropped (it is still in the store)
+      if (!GPVar.SteadyState && newPop.store)
+	{
+	  newPop.evaluateMembers (demeStart, demeStart+demeSize);
+	  newPop.pageOut (demeStart/demeSize, 1);
+	}
+      if (store)
+	pageOut (demeStart/demeSize, 0);
     }
 
-  // Now evaluate the new generation, if not steady state
-  if (!GPVar.SteadyState)
+  GPArena::select (previousArena);
+
+  // The new generation takes over the gene table
+  if (!GPVar.SteadyState && geneTable)
+    {
+      newPop.geneTable=geneTable;
+      geneTable=NULL;
+    }
+
+  // Now evaluate the new generation, if not steady state (and not
+  // done deme by deme already)
+  if (!GPVar.SteadyState && !newPop.store)
     newPop.evaluate ();
 
   // If demetic grouping is used, let members migrate into other demes
@@ -330,15 +475,35 @@ void GPPopulation::generate (GPPopulation& newPop)
 // a lot of checks in generate ().
 void GPPopulation::demeticMigration ()
 {
+  // If the population is kept in a store, the two demes involved are
+  // paged in when needed.  loaded and changed tell whether the
+  // current and the next deme are in memory and must be written back.
+  int loaded[2]={ 0, 0 }, changed[2]={ 0, 0 };
+
+  // Migration draws from a random stream of its own
+  GPRandomGenerator* stream=createRandomStream (generationNumber, 0, 0,
+						GPRandomMigration);
+  GPRandomGenerator* previousStream=GPRandomGenerator::select (stream);
+
   // For each deme select a wanderer that will be exchanged with a
   // selected member of the next deme.
   for (int demeStart=0; demeStart<containerSize ()-GPVar.DemeSize; 
        demeStart+=GPVar.DemeSize)
     {
+      int deme=demeStart/GPVar.DemeSize;
+
       // There is a user-defined possibility that demetic migration
       // will take place
       if (GPRandomPercent (GPVar.DemeticMigProbability))
 	{
+	  if (store)
+	    for (int i=0; i<2; i++)
+	      if (!loaded[i])
+		{
+		  pageIn (deme+i);
+		  loaded[i]=1;
+		}
+
 	  // Set selection range
 	  GPPopulationRange range1, range2;
 	  range1.firstSelectionPerDeme=1;
@@ -359,8 +524,27 @@ void GPPopulation::demeticMigration ()
 	  GPObject* p2=&get (r2);
 	  put (r2, *p1);
 	  put (r1, *p2);
+	  changed[0]=1;
+	  changed[1]=1;
+	}
+
+      // The current deme is finished, the next one becomes the
+      // current one
+      if (store)
+	{
+	  if (loaded[0])
+	    pageOut (deme, changed[0]);
+	  loaded[0]=loaded[1];
+	  changed[0]=changed[1];
+	  loaded[1]=0;
+	  changed[1]=0;
 	}
     }
+
+  if (store && loaded[0])
+    pageOut (containerSize ()/GPVar.DemeSize-1, changed[0]);
+  GPRandomGenerator::select (previousStream);
+  delete stream;
 }
 
 
@@ -370,6 +554,13 @@ void GPPopulation::demeticMigration ()
 // and depth.
 void GPPopulation::calculateStatistics ()
 {
+  // The members of a population in a store are not in memory
+  if (store)
+    {
+      storedStatistics ();
+      return;
+    }
+
   // Average values
   avgFitness=totalFitness () / (double) containerSize ();
   avgLength=(double)totalLength () / (double) containerSize ();
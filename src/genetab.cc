@@ -0,0 +1,245 @@
+
+// genetab.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Hash consing of genes.  The table keeps one gene for each subtree
+// that occurs in the population (see class GPGeneTable).
+
+#include "gp.h"
+
+
+
+// Initial number of buckets.  The table grows as soon as it holds
+// more genes than it has buckets.
+const long initialBuckets=1024;
+
+
+
+// Constructor
+GPGeneTable::GPGeneTable ()
+{
+  numBuckets=initialBuckets;
+  numEntries=0;
+  bucket=new Entry* [numBuckets];
+  for (long n=0; n<numBuckets; n++)
+    bucket[n]=NULL;
+}
+
+
+
+// Destructor.  The references the table holds are given back, so
+// genes that are no longer part of any tree are deleted.
+GPGeneTable::~GPGeneTable ()
+{
+  for (long n=0; n<numBuckets; n++)
+    {
+      Entry* e=bucket[n];
+      while (e)
+	{
+	  Entry* next=e->next;
+	  GPGene::release (e->gene);
+	  delete e;
+	  e=next;
+	}
+    }
+  delete [] bucket;
+}
+
+
+
+// The hash value of a gene is calculated from the address of its
+// node and the addresses of its children
+unsigned long GPGeneTable::hash (GPGene* g)
+{
+  unsigned long h=(unsigned long) &g->geneNode ();
+  for (int n=0; n<g->containerSize(); n++)
+    h=h*31+((unsigned long) g->NthChild (n) >> 3);
+  return h ^ (h >> 17);
+}
+
+
+
+// Two genes are identical, if they have the same node and the same
+// children.  This is correct only for genes with children that are
+// already in the table.
+int GPGeneTable::sameGene (GPGene* g1, GPGene* g2)
+{
+  if (&g1->geneNode ()!=&g2->geneNode ()
+      || g1->containerSize ()!=g2->containerSize ())
+    return 0;
+  for (int n=0; n<g1->containerSize(); n++)
+    if (g1->NthChild (n)!=g2->NthChild (n))
+      return 0;
+  return 1;
+}
+
+
+
+// Returns the gene in the table that is identical to the given one,
+// or NULL
+GPGene* GPGeneTable::find (GPGene* g)
+{
+  for (Entry* e=bucket[hash (g)%numBuckets]; e; e=e->next)
+    if (e->gene==g || sameGene (e->gene, g))
+      return e->gene;
+  return NULL;
+}
+
+
+
+// Doubles the number of buckets
+void GPGeneTable::grow ()
+{
+  long newNumBuckets=2*numBuckets;
+  Entry** newBucket=new Entry* [newNumBuckets];
+  for (long n=0; n<newNumBuckets; n++)
+    newBucket[n]=NULL;
+
+  for (long n=0; n<numBuckets; n++)
+    {
+      Entry* e=bucket[n];
+      while (e)
+	{
+	  Entry* next=e->next;
+	  long ix=hash (e->gene)%newNumBuckets;
+	  e->next=newBucket[ix];
+	  newBucket[ix]=e;
+	  e=next;
+	}
+    }
+
+  delete [] bucket;
+  bucket=newBucket;
+  numBuckets=newNumBuckets;
+}
+
+
+
+// Returns the gene of the table that is identical to the given one.
+// If there is none, the gene is put into the table.  The caller's
+// reference to the given gene is passed on to the returned gene.
+// The children are looked up first, but only if the gene itself is
+// not in the table already, so this costs O(number of new genes).
+GPGene* GPGeneTable::canonical (GPGene* g)
+{
+  // Is it already in the table?
+  GPGene* c=find (g);
+  if (c==g)
+    return g;
+
+  // Replace the children by the ones of the table.  As they are
+  // identical, this is correct even if the gene is shared.
+  for (int n=0; n<g->containerSize(); n++)
+    {
+      GPGene** childPtr=(GPGene**) g->getPointerAddress (n);
+      if (*childPtr)
+	*childPtr=canonical (*childPtr);
+    }
+
+  // Now look for an identical gene of the table.  If there is one,
+  // it replaces the given gene.  Otherwise the gene is put into the
+  // table.
+  if ((c=find (g)))
+    {
+      c->share ();
+      GPGene::release (g);
+      return c;
+    }
+
+  if (numEntries>=numBuckets)
+    grow ();
+  Entry* e=new Entry;
+  long ix=hash (g)%numBuckets;
+  e->gene=g->share ();
+  e->next=bucket[ix];
+  bucket[ix]=e;
+  numEntries++;
+  return g;
+}
+
+
+
+// Replace all trees of the GP by the ones of the table
+void GPGeneTable::insert (GP& gp)
+{
+  for (int n=0; n<gp.containerSize(); n++)
+    {
+      GPGene** rootPtr=(GPGene**) gp.getPointerAddress (n);
+      if (*rootPtr)
+	*rootPtr=canonical (*rootPtr);
+    }
+}
+
+
+
+// Removes the genes that are not referenced by any tree, e.g. the
+// table holds the only reference.  Deleting a gene gives back its
+// references to its children, so we repeat this until nothing is
+// removed any more.
+void GPGeneTable::purge ()
+{
+  long removed;
+  do
+    {
+      removed=0;
+      for (long n=0; n<numBuckets; n++)
+	{
+	  Entry** ePtr=&bucket[n];
+	  while (*ePtr)
+	    {
+	      Entry* e=*ePtr;
+	      if (e->gene->shareCount==0)
+		{
+		  *ePtr=e->next;
+		  GPGene::release (e->gene);
+		  delete e;
+		  numEntries--;
+		  removed++;
+		}
+	      else
+		ePtr=&e->next;
+	    }
+	}
+    }
+  while (removed);
+}
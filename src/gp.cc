@@ -51,6 +51,47 @@ Fax:    (UK) 061 745 5999
 using namespace std;
 
 
+// Copy constructor.  If subtrees are shared, the trees are not
+// copied, but referenced by both GPs
+#if GPSHARESUBTREES
+GP::GP (const GP& gpo) : GPContainer (gpo.containerSize ())
+{
+  for (int n=0; n<containerSize(); n++)
+    if (gpo.container[n])
+      container[n]=((GPGene*) gpo.container[n])->share ();
+#else
+GP::GP (const GP& gpo) : GPContainer (gpo)
+{
+#endif
+  stdFitness=gpo.stdFitness; 
+  fitnessValid=gpo.fitnessValid;
+  GPlength=gpo.GPlength; 
+  GPdepth=gpo.GPdepth;
+  timePerNode=gpo.timePerNode;
+  code=NULL;
+}
+
+
+
+// Destructor.  Shared trees are only given back, the container
+// deletes the others.
+GP::~GP ()
+{
+  if (code)
+    delete code;
+#if GPSHARESUBTREES
+  GPGene* current;
+  for (int n=0; n<containerSize(); n++)
+    if ((current=NthGene (n)))
+      {
+	GPGene::release (current);
+	container[n]=NULL;
+      }
+#endif
+}
+
+
+
 // Simply print out the first Gene and then all ADF's.
 void GP::printOn (ostream& os)
 {
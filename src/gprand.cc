@@ -42,35 +42,160 @@ Fax:    (UK) 061 745 5999
 
 ------------------------------------------------------------------- */
 
-// Adapted from ``Numerical Recipes in C'' (1992) by Press, Flannery,
-// Teukolsky and Vetterling.  This is a great book indeed, and you
-// should have at least a look at it!
-
 #include "gp.h"
 
 
 
-// Seed for random generator
-static long idum=-1;
+// The seed all streams are made from, and the stream of the program
+static long seed=1;
+static GPRandomStream programStream (-1, 0, 0, GPRandomProgram);
+
+GPThreadLocal GPRandomGenerator* GPRandomGenerator::current=NULL;
+
+
+
+// The finalizer of SplitMix64, to mix the parts of a key
+static unsigned long long mix (unsigned long long z)
+{
+  z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+  z=(z^(z>>27))*0x94d049bb133111ebULL;
+  return z^(z>>31);
+}
+
+
+
+// Returns a number in the range 0..n-1 (n must be in the range
+// 1..2^32).  The upper 32 bits of a number are multiplied by n, and
+// the upper half of the product is the result.  Some results would
+// come up once more often than the others, so those products whose
+// lower half is below 2^32 mod n are thrown away.  This is rare, and
+// the division is needed only if the lower half is below n.
+long GPRandomGenerator::below (long n)
+{
+#if GPINTERNALCHECK
+  if (n<1)
+    GPExitSystem ("GPRandomGenerator::below", "Range is empty");
+#endif
+
+  unsigned long long range=(unsigned long long) n;
+  unsigned long long m=(next ()>>32)*range;
+  if ((m & 0xffffffffULL)<range)
+    {
+      unsigned long long threshold=(0x100000000ULL-range)%range;
+      while ((m & 0xffffffffULL)<threshold)
+	m=(next ()>>32)*range;
+    }
+  return (long) (m>>32);
+}
+
+
+
+// Fills the array with num numbers in the range start..start+n-1 the
+// way below() does, but with both halves of each number of the
+// generator
+void GPRandomGenerator::indices (int* indices, int num, int start, 
+				 int n)
+{
+#if GPINTERNALCHECK
+  if (n<1)
+    GPExitSystem ("GPRandomGenerator::indices", "Range is empty");
+#endif
+
+  unsigned long long range=(unsigned long long) n;
+  unsigned long long threshold=(0x100000000ULL-range)%range;
+  unsigned long long bits=0;
+  int halves=0;
+  for (int i=0; i<num; i++)
+    {
+      unsigned long long m;
+      do
+	{
+	  if (!halves)
+	    {
+	      bits=next ();
+	      halves=2;
+	    }
+	  m=(bits & 0xffffffffULL)*range;
+	  bits>>=32;
+	  halves--;
+	}
+      while ((m & 0xffffffffULL)<threshold);
+      indices[i]=start+(int) (m>>32);
+    }
+}
+
+
+
+// Makes the key of a stream from the seed and the parts given.  Each
+// part is mixed in on its own, so streams whose parts are swapped
+// have different keys.
+GPRandomStream::GPRandomStream (int generation, int deme, int individual, 
+				GPRandomUse use)
+{
+  key=mix ((unsigned long long) seed+0x9e3779b97f4a7c15ULL);
+  key=mix (key+(unsigned long long) (long long) generation);
+  key=mix (key+(unsigned long long) (long long) deme);
+  key=mix (key+(unsigned long long) (long long) individual);
+  key=mix (key+(unsigned long long) use);
+  counter=0;
+}
+
+
+
+// The state of xoshiro256** is set with SplitMix64, as its authors
+// recommend (it must not be all zero)
+GPXoshiroGenerator::GPXoshiroGenerator (unsigned long long seed)
+{
+  for (int i=0; i<4; i++)
+    s[i]=mix (seed+(i+1)*0x9e3779b97f4a7c15ULL);
+}
+
+
+
+// Advances the generator by 2^128 numbers
+void GPXoshiroGenerator::jump ()
+{
+  static const unsigned long long polynomial[4]={ 
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+  unsigned long long t[4]={ 0, 0, 0, 0 };
+
+  for (int i=0; i<4; i++)
+    for (int b=0; b<64; b++)
+      {
+	if (polynomial[i] & (1ULL<<b))
+	  for (int j=0; j<4; j++)
+	    t[j]^=s[j];
+	next ();
+      }
+  for (int j=0; j<4; j++)
+    s[j]=t[j];
+}
+
+
+
+// Adapted from ``Numerical Recipes in C'' (1992) by Press, Flannery,
+// Teukolsky and Vetterling.  This is a great book indeed, and you
+// should have at least a look at it!
 
 #define IA 16807
 #define IM 2147483647
-#define AM (1.0/IM)
 #define IQ 127773
 #define IR 2836
-#define NTAB 32
-#define NDIV (1+(IM-1)/NTAB)
-#define EPS 1.2e-7
+#define NDIV (1+(IM-1)/tableSize)
 #define RNMX (IM-1)
 
-// This routine is not Multi-Thread-save because a global variable is
-// used.  Returns a random number in range 0..RNMX.
-long GPrand ()
+GPLegacyGenerator::GPLegacyGenerator (long seed)
+{
+  idum=-seed;
+  iy=0;
+}
+
+// Returns a random number in range 0..RNMX.
+long GPLegacyGenerator::ran1 ()
 {
   int j;
   long k;
-  static long iy=0;
-  static long iv[NTAB];
 
   if (idum <= 0 || !iy) 
     {
@@ -78,13 +203,13 @@ long GPrand ()
 	idum=1;
       else 
 	idum = -(idum);
-      for (j=NTAB+7;j>=0;j--) 
+      for (j=tableSize+7;j>=0;j--) 
 	{
 	  k=(idum)/IQ;
 	  idum=IA*(idum-k*IQ)-IR*k;
 	  if (idum < 0) 
 	    idum += IM;
-	  if (j < NTAB) 
+	  if (j < tableSize) 
 	    iv[j] = idum;
 	}
       iy=iv[0];
@@ -104,28 +229,66 @@ long GPrand ()
 
 #undef IA
 #undef IM
-#undef AM
 #undef IQ
 #undef IR
-#undef NTAB
 #undef NDIV
-#undef EPS
 #undef RNMX
 
 
 
-// Seed random generator
-void GPsrand (long seed)
+// The generator selected on this thread, or the stream of the program
+static inline GPRandomGenerator& generator ()
 {
-  idum=-seed;
+  GPRandomGenerator* g=GPRandomGenerator::selected ();
+  return g ? *g : programStream;
+}
+
+
+
+// Returns a random number in range 0..2^31-1
+long GPrand ()
+{
+  return (long) (generator ().next ()>>33);
+}
+
+
+
+// Returns a random number in range 0..n-1
+long GPRandomBelow (long n)
+{
+  return generator ().below (n);
+}
+
+
+
+// Returns a random number in range [0,1)
+double GPRandomUniform ()
+{
+  return generator ().uniform ();
+}
+
+
+
+// Fills the array with num random numbers in range start..start+n-1
+void GPRandomIndices (int* indices, int num, int start, int n)
+{
+  generator ().indices (indices, num, start, n);
+}
+
+
+
+// Seed random generator.  The stream of the program starts again.
+void GPsrand (long seed_)
+{
+  seed=seed_;
+  programStream=GPRandomStream (-1, 0, 0, GPRandomProgram);
 }
 
 
 
 // Returns either 0 or 1 by random.  The probability is given by the
-// argument in the range 0..100.0 (which is meant to be percent).  The
-// resolution of the argument can be as low as 0.0001.
+// argument in the range 0..100.0 (which is meant to be percent).
 int GPRandomPercent (double percent)
 {
-  return (double) (GPrand () % 1000000l) < percent*10000.0;
+  return GPRandomUniform ()*100.0 < percent;
 }
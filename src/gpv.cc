@@ -72,6 +72,13 @@ GPVariables::GPVariables ()
   ShrinkMutationProbability=0.0;
   AddBestToNewPopulation=1;
   SteadyState=1;
+  ArenaAllocation=0;
+  HashConsing=0;
+  Recycling=0;
+  OutOfCore=0;
+  FitnessMemo=0;
+  ResultCacheSize=16384;
+  EvaluationThreads=1;
 }
 
 
@@ -94,6 +101,13 @@ GPVariables::GPVariables (const GPVariables& gpo) : GPObject(gpo)
   ShrinkMutationProbability=gpo.ShrinkMutationProbability;
   AddBestToNewPopulation=gpo.AddBestToNewPopulation;
   SteadyState=gpo.SteadyState;
+  ArenaAllocation=gpo.ArenaAllocation;
+  HashConsing=gpo.HashConsing;
+  Recycling=gpo.Recycling;
+  OutOfCore=gpo.OutOfCore;
+  FitnessMemo=gpo.FitnessMemo;
+  ResultCacheSize=gpo.ResultCacheSize;
+  EvaluationThreads=gpo.EvaluationThreads;
 }
 
 
@@ -154,12 +168,23 @@ void GPVariables::printOn (ostream& os)
      << "\nShrinkMutationProbability = " << ShrinkMutationProbability
      << "\nAddBestToNewPopulation    = " << AddBestToNewPopulation
      << "\nSteadyState               = " << SteadyState
+     << "\nArenaAllocation           = " << ArenaAllocation
+     << "\nHashConsing               = " << HashConsing
+     << "\nRecycling                 = " << Recycling
+     << "\nOutOfCore                 = " << OutOfCore
+     << "\nFitnessMemo               = " << FitnessMemo
+     << "\nResultCacheSize           = " << ResultCacheSize
+     << "\nEvaluationThreads         = " << EvaluationThreads
      << endl;
 }
 
 
 
-// Load operation
+// Load operation.  Only the parameters of the algorithm are loaded
+// and saved.  The settings of how a run is carried out
+// (ArenaAllocation, HashConsing, Recycling, OutOfCore, FitnessMemo,
+// ResultCacheSize, EvaluationThreads) keep their values, so files
+// saved by earlier versions can still be loaded.
 char* GPVariables::load (istream& is)
 {
   is >> PopulationSize;
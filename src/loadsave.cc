@@ -104,4 +104,5 @@ void GPRegisterKernelClasses ()
   GPRegisterClass (new GPGene());
   GPRegisterClass (new GP());
   GPRegisterClass (new GPPopulation());
+  GPRegisterClass (new GPFlat());
 }
@@ -60,8 +60,9 @@ const int swapAttempts=5;
 // but functions can only be swapped with other functions with the
 // same arguments.  This means that the mutation does not have to
 // create new branches when different function types are swapped which
-// seems implicitly wrong
-void GP::swapMutation (GPAdfNodeSet& adfNs)
+// seems implicitly wrong.  Returns 0 if no node with a different value
+// was found, so that the GP is unchanged.
+int GP::swapMutation (GPAdfNodeSet& adfNs)
 {
 #if GPINTERNALCHECK
   if (containerSize()==0)
@@ -70,7 +71,7 @@ void GP::swapMutation (GPAdfNodeSet& adfNs)
 
   // Point to a particular adf genetic tree and get that node set for
   // that tree.  
-  int randtree = GPrand() % containerSize ();
+  int randtree = GPRandomBelow (containerSize ());
   GPNodeSet& ns=*adfNs.NthNodeSet (randtree);
 
   GPGene* rootGene=NthGene (randtree);
@@ -78,8 +79,14 @@ void GP::swapMutation (GPAdfNodeSet& adfNs)
     {
       // Select a gene on that branch, e.g. get the address of the
       // pointer that points to the gene
-      GPGene& g=**(rootGene->
-		   choose ((GPGene**)getPointerAddress (randtree)));
+      GPGene** rootGenePtr=(GPGene**)getPointerAddress (randtree);
+      int nodeNumber;
+      GPGene** genePtr=rootGene->choose (rootGenePtr, &nodeNumber);
+#if GPSHARESUBTREES
+      // The gene is changed, so it must not be shared
+      genePtr=GPGene::unsharePath (rootGenePtr, nodeNumber, 1);
+#endif
+      GPGene& g=**genePtr;
   
       // First of all we have to work out how many arguments this
       // function (if it is one) has.  There are two ways: Using
@@ -106,11 +113,14 @@ void GP::swapMutation (GPAdfNodeSet& adfNs)
 		{
 		  // replace old function with new one and stop loop
 		  g.node=node;
-		  break;
+		  return 1;
 		}
 	    }
 	}
     }
+
+  // No node was found, the GP is unchanged
+  return 0;
 }
 
 
@@ -141,18 +151,22 @@ int GPGene::countFunctions ()
 // the adress of a pointer to the selected gene.  This makes the
 // shrink mutation very simple.  The object this function is called
 // for is of no importance, but is usually the root gene.  The
-// function returns NULL if no function nodes exists.
-GPGene** GPGene::chooseFunctionNode (GPGene** rootPtr)
+// function returns NULL if no function nodes exists.  If nodeNumber
+// is given, the position of the selected gene is returned there (see
+// updatePath()).
+GPGene** GPGene::chooseFunctionNode (GPGene** rootPtr, int* nodeNumber)
 {
   // Calculate the length of the subtree starting at the given gene
   // and calculate a random number between 1 -> totalFunctions
   int totalFunctions=(**rootPtr).countFunctions ();
   if (totalFunctions>0)
     {
-      int randomFunc = (GPrand() % totalFunctions) + 1;
+      int randomFunc = GPRandomBelow (totalFunctions) + 1;
 
       // Find function gene
-      GPGene **pg=findNthNode (rootPtr, 1, randomFunc);
+      if (nodeNumber)
+	*nodeNumber=0;
+      GPGene **pg=findNthNode (rootPtr, 1, randomFunc, nodeNumber);
 #if GPINTERNALCHECK
       if (!pg)
 	GPExitSystem ("GPGene::chooseFunctionNode", 
@@ -171,7 +185,8 @@ GPGene** GPGene::chooseFunctionNode (GPGene** rootPtr)
 // This block of code performs shrink mutation on a genetic program.
 // A function node is chosen by random from a random GP tree, and one
 // of the children of the function takes the position of the parent.
-void GP::shrinkMutation ()
+// Returns 0 if there is no function node, so that the GP is unchanged.
+int GP::shrinkMutation ()
 {
 #if GPINTERNALCHECK
   if (containerSize()==0)
@@ -179,7 +194,7 @@ void GP::shrinkMutation ()
 #endif
 
   // Select a particular adf genetic tree by random
-  int randtree = GPrand() % containerSize ();
+  int randtree = GPRandomBelow (containerSize ());
 
   // Get root gene
   GPGene* rootGene=NthGene (randtree);
@@ -188,16 +203,29 @@ void GP::shrinkMutation ()
       // Select a function gene on that branch, e.g. get the address
       // of the pointer that points to the gene.
       GPGene** rootGenePtr=(GPGene**)getPointerAddress (randtree);
-      GPGene** g=rootGene->chooseFunctionNode (rootGenePtr);
+      int nodeNumber;
+      GPGene** g=rootGene->chooseFunctionNode (rootGenePtr, &nodeNumber);
 
       // If function node exists (it may happen that there is no
       // function node at all)
       if (g)
 	{
+#if GPSHARESUBTREES
+	  // The parent of the function gene is changed, so it must
+	  // not be shared
+	  g=GPGene::unsharePath (rootGenePtr, nodeNumber, 0);
+#endif
+
 	  // Choose one subtree (or child) of the chosen function gene
-	  int subTree=GPrand() % (**g).containerSize();
+	  int subTree=GPRandomBelow ((**g).containerSize());
 	  GPGene* child=(**g).NthChild (subTree);
 
+#if GPSHARESUBTREES
+	  // Take another reference to the child, so that it won't be
+	  // deleted if the parent is given back
+	  child->share ();
+	  GPGene::release (*g);
+#else
 	  // Set the pointer the parent uses to point to the child to
 	  // NULL, so that the child won't be deleted if the parent is
 	  // killed.
@@ -206,15 +234,20 @@ void GP::shrinkMutation ()
 
 	  // Delete parent.
 	  delete *g;
+#endif
       
 	  // Put the child on the position of the former parent
 	  *g=child;
 
-	  // Recalculate length and depth
+	  // Recalculate length and depth of the genes above the
+	  // changed one, and of the GP
+	  (**rootGenePtr).updatePath (nodeNumber);
 	  calcLength ();
 	  calcDepth ();
+	  return 1;
 	}
     }
+  return 0;
 }
 
 
@@ -224,16 +257,12 @@ void GP::shrinkMutation ()
 void GP::mutate (GPVariables& GPVar, GPAdfNodeSet& adfNs)
 {
   if (GPRandomPercent (GPVar.SwapMutationProbability))
-    {
-      swapMutation (adfNs);
-      fitnessValid=0;
-    }
+    if (swapMutation (adfNs))
+      invalidateFitness ();
 
   if (GPRandomPercent (GPVar.ShrinkMutationProbability))
-    {
-      shrinkMutation ();
-      fitnessValid=0;
-    }
+    if (shrinkMutation ())
+      invalidateFitness ();
 }
 
 
@@ -0,0 +1,549 @@
+
+// native.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Native code for genetic programs.  The trees of the GPs are written
+// as C++ functions to a source file, using the sources the user gave
+// the nodes, and compiled by the system's compiler into a shared
+// object.  This is loaded with dlopen(), and the functions are called
+// instead of evaluating the trees.  Compiling takes a while, so all
+// GPs of a generation that are not evaluated yet are compiled
+// together, and GPs are recognised by their trees, so that
+// unchanged GPs are not compiled again.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <fstream>
+#include <strstream>
+#include "gp.h"
+
+using std::ofstream;
+using std::ostrstream;
+using std::ends;
+
+
+
+// The compiler call.  The source and output file are appended.
+// Contracting floating point operations is switched off, so that the
+// results are the same as the ones of the tree.  Inlining the
+// functions of the prelude into the deeply nested expressions makes
+// the compiler several times slower, while the code is only a little
+// faster, so it is switched off as well.
+static char* defaultCommand=
+  "g++ -O2 -fno-inline -fPIC -shared -ffp-contract=off -x c++";
+
+
+
+// A compiled GP, or one that is queued for the next build().  The
+// function is NULL as long as it is not compiled.
+struct GPNativeEntry
+{
+  unsigned long hash;
+  int keyLength;
+  int* key;
+  int id;
+  GPPrimitive function;
+  GPNativeEntry* next;
+};
+
+
+
+void GPNodeSet::setSource (int value, char* src)
+{
+  if (shareCount)
+    GPExitSystem ("GPNodeSet::setSource", 
+		  "Node set is shared and can't be changed");
+
+  GPNode* node=searchForNode (value);
+  if (!node)
+    GPExitSystem ("GPNodeSet::setSource", "Node not in node set");
+
+  if (!source)
+    {
+      source=new char*[containerSize ()];
+      for (int n=0; n<containerSize (); n++)
+	source[n]=NULL;
+    }
+  source[indexOfNode (node)]=GPNode::internString (src);
+}
+
+
+
+// The number of arguments of each tree is the highest argument
+// number of its node set
+GPNativeCompiler::GPNativeCompiler (GPAdfNodeSet& adfNs_, char* prelude_,
+				    char* command_)
+{
+  adfNs=adfNs_.share ();
+  prelude=prelude_;
+  command=command_ ? command_ : defaultCommand;
+
+  treeArgs=new int[adfNs->containerSize ()];
+  for (int t=0; t<adfNs->containerSize (); t++)
+    {
+      GPNodeSet& ns=*adfNs->NthNodeSet (t);
+      treeArgs[t]=0;
+      for (int n=0; n<ns.containerSize (); n++)
+	{
+	  GPInstruction* i=ns.NthPrimitive (n);
+	  if (i && i->opcode==GPArgument && i->operand>=treeArgs[t])
+	    treeArgs[t]=i->operand+1;
+	}
+    }
+
+  tableSize=1024;
+  table=new GPNativeEntry*[tableSize];
+  for (int n=0; n<tableSize; n++)
+    table[n]=NULL;
+  numEntries=0;
+  queueSize=64;
+  queue=new GPNativeEntry*[queueSize];
+  queued=0;
+  handleSize=16;
+  handle=new void*[handleSize];
+  numHandles=0;
+  keySize=256;
+  key=new int[keySize];
+  keyLength=0;
+}
+
+
+
+GPNativeCompiler::~GPNativeCompiler ()
+{
+  for (int n=0; n<tableSize; n++)
+    while (table[n])
+      {
+	GPNativeEntry* e=table[n];
+	table[n]=e->next;
+	delete [] e->key;
+	delete e;
+      }
+  delete [] table;
+  delete [] queue;
+  for (int n=0; n<numHandles; n++)
+    dlclose (handle[n]);
+  delete [] handle;
+  delete [] key;
+  delete [] treeArgs;
+  GPAdfNodeSet::release (adfNs);
+}
+
+
+
+void GPNativeCompiler::addKey (int k)
+{
+  if (keyLength==keySize)
+    {
+      int* tmp=new int[keySize*2];
+      memcpy (tmp, key, keySize*sizeof (int));
+      delete [] key;
+      key=tmp;
+      keySize*=2;
+    }
+  key[keyLength++]=k;
+}
+
+
+
+// Appends the node indices of a tree in prefix order to the key
+void GPNativeCompiler::keyGene (GPGene& g, GPNodeSet& ns)
+{
+  addKey (ns.indexOfNode (&g.geneNode ()));
+  for (int n=0; n<g.containerSize (); n++)
+    keyGene (*g.NthChild (n), ns);
+}
+
+
+
+// Makes the key of a GP
+void GPNativeCompiler::makeKey (GP& gp)
+{
+  if (gp.isA ()==GPFlatID)
+    GPExitSystem ("GPNativeCompiler::makeKey", 
+		  "GPFlat can't be compiled to native code");
+
+  keyLength=0;
+  for (int t=0; t<gp.containerSize (); t++)
+    {
+      addKey (-1);
+      if (gp.NthGene (t))
+	keyGene (*gp.NthGene (t), *adfNs->NthNodeSet (t));
+    }
+}
+
+
+
+// Searches the entry of a GP, which is created (and queued) if it
+// doesn't exist and insert is set
+GPNativeEntry* GPNativeCompiler::lookup (GP& gp, int insert)
+{
+  makeKey (gp);
+
+  // FNV-1a hash of the key
+  unsigned long hash=2166136261UL;
+  for (int n=0; n<keyLength; n++)
+    hash=(hash^(unsigned long) key[n])*16777619UL;
+
+  GPNativeEntry* e;
+  for (e=table[hash%tableSize]; e; e=e->next)
+    if (e->hash==hash && e->keyLength==keyLength 
+	&& !memcmp (e->key, key, keyLength*sizeof (int)))
+      return e;
+  if (!insert)
+    return NULL;
+
+  // Enlarge the table if it gets full
+  if (numEntries==tableSize)
+    {
+      GPNativeEntry** tmp=new GPNativeEntry*[tableSize*2];
+      for (int n=0; n<tableSize*2; n++)
+	tmp[n]=NULL;
+      for (int n=0; n<tableSize; n++)
+	while (table[n])
+	  {
+	    GPNativeEntry* m=table[n];
+	    table[n]=m->next;
+	    m->next=tmp[m->hash%(tableSize*2)];
+	    tmp[m->hash%(tableSize*2)]=m;
+	  }
+      delete [] table;
+      table=tmp;
+      tableSize*=2;
+    }
+
+  e=new GPNativeEntry;
+  e->hash=hash;
+  e->keyLength=keyLength;
+  e->key=new int[keyLength];
+  memcpy (e->key, key, keyLength*sizeof (int));
+  e->id=numEntries;
+  e->function=NULL;
+  e->next=table[hash%tableSize];
+  table[hash%tableSize]=e;
+  numEntries++;
+
+  if (queued==queueSize)
+    {
+      GPNativeEntry** tmp=new GPNativeEntry*[queueSize*2];
+      memcpy (tmp, queue, queueSize*sizeof (GPNativeEntry*));
+      delete [] queue;
+      queue=tmp;
+      queueSize*=2;
+    }
+  queue[queued++]=e;
+  return e;
+}
+
+
+
+// Queues a GP for the next build(), if it isn't compiled already
+void GPNativeCompiler::add (GP& gp)
+{
+  lookup (gp, 1);
+}
+
+
+
+GPPrimitive GPNativeCompiler::function (GP& gp)
+{
+  GPNativeEntry* e=lookup (gp, 0);
+  return e ? e->function : NULL;
+}
+
+
+
+// Returns the position behind the subtree at k of the key
+static int* skipNode (int* k, GPNodeSet& ns)
+{
+  int args=ns.NthNode (*k)->arguments ();
+  k++;
+  for (int n=0; n<args; n++)
+    k=skipNode (k, ns);
+  return k;
+}
+
+
+
+// Writes the expression of the subtree at k of the key.  The tree
+// functions are called <name>_<tree>, their arguments a0, a1, ...
+void GPNativeCompiler::writeNode (ostream& os, char* name, int* k, 
+				  int tree)
+{
+  GPNodeSet& ns=*adfNs->NthNodeSet (tree);
+  int args=ns.NthNode (*k)->arguments ();
+  GPInstruction* i=ns.NthPrimitive (*k);
+
+  // The positions of the arguments
+  int* arg[9];
+  if (args>9)
+    GPExitSystem ("GPNativeCompiler::writeNode", "Too many arguments");
+  for (int n=0; n<args; n++)
+    arg[n]=n ? skipNode (arg[n-1], ns) : k+1;
+
+  if (i && i->opcode==GPArgument)
+    {
+      os << 'a' << i->operand;
+      return;
+    }
+
+  if (i && i->opcode==GPAdfCall)
+    {
+      if (args!=treeArgs[i->operand])
+	GPExitSystem ("GPNativeCompiler::writeNode", 
+		      "Wrong number of arguments for ADF call");
+      os << name << '_' << i->operand << " (";
+      for (int n=0; n<args; n++)
+	{
+	  writeNode (os, name, arg[n], tree);
+	  os << ", ";
+	}
+      os << "context)";
+      return;
+    }
+
+  char* src=ns.NthSource (*k);
+  if (!src)
+    GPExitSystem ("GPNativeCompiler::writeNode", "No source for node");
+  for (; *src; src++)
+    if (*src=='%' && src[1]=='%')
+      os << *++src;
+    else if (*src=='%' && src[1]>='1' && src[1]<='9')
+      {
+	int n=*++src-'1';
+	if (n>=args)
+	  GPExitSystem ("GPNativeCompiler::writeNode", 
+			"Argument of source doesn't exist");
+	os << '(';
+	writeNode (os, name, arg[n], tree);
+	os << ')';
+      }
+    else
+      os << *src;
+}
+
+
+
+// Writes the functions of the trees of a key and the function name,
+// which calls the main tree.  linkage is put before the latter.
+void GPNativeCompiler::writeFunction (ostream& os, char* name, 
+				      char* linkage, int* key, int length)
+{
+  int numTrees=adfNs->containerSize ();
+  for (int t=0; t<numTrees; t++)
+    {
+      os << "static double " << name << '_' << t << " (";
+      for (int a=0; a<treeArgs[t]; a++)
+	os << "double, ";
+      os << "void*);\n";
+    }
+
+  int* k=key;
+  for (int t=0; t<numTrees; t++)
+    {
+      os << "static double " << name << '_' << t << " (";
+      for (int a=0; a<treeArgs[t]; a++)
+	os << "double a" << a << ", ";
+      os << "void* context)\n{\n  return ";
+      k++;
+      if (k<key+length && *k!=-1)
+	{
+	  writeNode (os, name, k, t);
+	  k=skipNode (k, *adfNs->NthNodeSet (t));
+	}
+      else
+	os << "0.0";
+      os << ";\n}\n";
+    }
+
+  os << linkage << "double " << name 
+     << " (double* args, void* context)\n{\n  return " 
+     << name << "_0 (";
+  for (int a=0; a<treeArgs[0]; a++)
+    os << "args[" << a << "], ";
+  os << "context);\n}\n";
+}
+
+
+
+// Compiles the queued GPs into one shared object and loads it.  The
+// files are removed afterwards.
+void GPNativeCompiler::build ()
+{
+  if (!queued)
+    return;
+
+  const char* dir=getenv ("TMPDIR");
+  if (!dir || !*dir)
+    dir="/tmp";
+  char* name=new char[strlen (dir)+20];
+  strcpy (name, dir);
+  strcat (name, "/gpnativeXXXXXX");
+  int fd=mkstemp (name);
+  if (fd<0)
+    GPExitSystem ("GPNativeCompiler::build", 
+		  "Can't create temporary file");
+  close (fd);
+  char* object=new char[strlen (name)+4];
+  strcpy (object, name);
+  strcat (object, ".so");
+
+  ofstream os (name);
+  if (prelude)
+    os << prelude << '\n';
+  // The trees are written from the keys, so the GPs themselves
+  // needn't exist any more
+  char symbol[32];
+  for (int n=0; n<queued; n++)
+    {
+      os << '\n';
+      sprintf (symbol, "gp%d", queue[n]->id);
+      writeFunction (os, symbol, "extern \"C\" ", queue[n]->key, 
+		     queue[n]->keyLength);
+    }
+  os.close ();
+  if (!os)
+    GPExitSystem ("GPNativeCompiler::build", "Can't write source file");
+
+  char* call=new char[strlen (command)+2*strlen (name)+16];
+  sprintf (call, "%s %s -o %s", command, name, object);
+  int status=system (call);
+  delete [] call;
+  unlink (name);
+  if (status)
+    {
+      unlink (object);
+      GPExitSystem ("GPNativeCompiler::build", "Compiler failed");
+    }
+
+  void* h=dlopen (object, RTLD_NOW | RTLD_LOCAL);
+  unlink (object);
+  delete [] name;
+  delete [] object;
+  if (!h)
+    GPExitSystem ("GPNativeCompiler::build", dlerror ());
+
+  if (numHandles==handleSize)
+    {
+      void** tmp=new void*[handleSize*2];
+      memcpy (tmp, handle, handleSize*sizeof (void*));
+      delete [] handle;
+      handle=tmp;
+      handleSize*=2;
+    }
+  handle[numHandles++]=h;
+
+  for (int n=0; n<queued; n++)
+    {
+      sprintf (symbol, "gp%d", queue[n]->id);
+      queue[n]->function=(GPPrimitive) dlsym (h, symbol);
+      if (!queue[n]->function)
+	GPExitSystem ("GPNativeCompiler::build", "Function not found");
+    }
+  queued=0;
+}
+
+
+
+// Writes a GP as a C function that needs nothing but the prelude.  If
+// samples are given, a test program follows, which is compiled if
+// GPEXPORTTEST is defined: It calls the function with each sample
+// (sampleSize values) as context and compares the result with the
+// expected one, which the user got from the trees.
+void GPNativeCompiler::exportFunction (ostream& os, GP& gp, char* name, 
+				       int numSamples, int sampleSize, 
+				       double* samples, double* expected)
+{
+  makeKey (gp);
+
+  // The GP as comment, without an end of comment in it
+  ostrstream text;
+  text << gp << ends;
+  os << "/* " << name << ": generated by gpc++ from the GP\n\n";
+  for (char* c=text.str (); *c; c++)
+    os << *c << (c[0]=='*' && c[1]=='/' ? " " : "");
+  text.freeze (0);
+  os << "*/\n\n";
+  if (prelude)
+    os << prelude << '\n';
+  writeFunction (os, name, "", key, keyLength);
+  if (!numSamples)
+    return;
+
+  int oldPrecision=os.precision (17);
+  os << "\n#ifdef GPEXPORTTEST\n"
+     << "#include <stdio.h>\n"
+     << "#include <math.h>\n\n"
+     << "static double " << name << "_sample[" << numSamples << "][" 
+     << sampleSize << "]={\n";
+  for (int n=0; n<numSamples; n++)
+    {
+      os << "  {";
+      for (int i=0; i<sampleSize; i++)
+	os << (i ? ", " : " ") << samples[n*sampleSize+i];
+      os << " },\n";
+    }
+  os << "};\n"
+     << "static double " << name << "_expected[" << numSamples 
+     << "]={\n";
+  for (int n=0; n<numSamples; n++)
+    os << "  " << expected[n] << ",\n";
+  os << "};\n\n"
+     << "int main (void)\n{\n"
+     << "  int n, errors=0;\n"
+     << "  for (n=0; n<" << numSamples << "; n++)\n    {\n"
+     << "      double e=" << name << "_expected[n];\n"
+     << "      double r=" << name << " (0, " << name << "_sample[n]);\n"
+     << "      if (fabs (r-e)>1e-9*(1.0+fabs (e)))\n        {\n"
+     << "          printf (\"Sample %d: %.17g instead of %.17g\\n\", "
+     << "n, r, e);\n"
+     << "          errors++;\n        }\n    }\n"
+     << "  printf (\"" << name << ": %d of %d samples wrong\\n\", errors, "
+     << numSamples << ");\n"
+     << "  return errors!=0;\n}\n"
+     << "#endif\n";
+  os.precision (oldPrecision);
+}
@@ -57,22 +57,87 @@ Fax:    (UK) 061 745 5999
 
 using namespace std;
 
-// Copy Constructor
+// Copy Constructor.  The string is interned, so it's not copied.
 GPNode::GPNode (const GPNode& gpo) : GPObject(gpo) 
 {
   nodeValue=gpo.nodeValue; 
   numOfArgs=gpo.numOfArgs; 
-  representation=copyString (gpo.representation);
+  representation=gpo.representation;
+  shareCount=0;
+  registerNode ();
 }
 
 
 
-// Duplicate a string
-char *GPNode::copyString (char *str)
+#if GPCOMPACTNODES
+// The table of all nodes
+GPNode** GPNode::nodeTable=NULL;
+int GPNode::nodeTableSize=0;
+
+
+
+// Enter the node into the first free entry of the table of all
+// nodes.  The table is enlarged if necessary, but can't have more
+// than 65536 entries, as the index has to fit into 16 bits.
+void GPNode::registerNode ()
+{
+  int ix;
+  for (ix=1; ix<nodeTableSize; ix++)
+    if (!nodeTable[ix])
+      break;
+
+  if (ix>=nodeTableSize)
+    {
+      if (ix>=65536)
+	GPExitSystem ("GPNode::registerNode", "Too many nodes");
+      int newSize=nodeTableSize ? 2*nodeTableSize : 64;
+      GPNode** newTable=new GPNode* [newSize];
+      for (int n=0; n<newSize; n++)
+	newTable[n]=n<nodeTableSize ? nodeTable[n] : NULL;
+      delete [] nodeTable;
+      nodeTable=newTable;
+      nodeTableSize=newSize;
+    }
+
+  nodeTable[ix]=this;
+  nodeIndex=(unsigned short) ix;
+}
+#endif
+
+
+
+// The table of interned node strings.  It only grows, and there are
+// usually only a few dozen different strings, so a small fixed number
+// of hash chains is enough.
+struct GPInternedString
+{
+  char* str;
+  GPInternedString* next;
+};
+const int internBuckets=256;
+static GPInternedString* internTable[internBuckets];
+
+
+
+// Return the interned copy of a string.  The first time a string is
+// seen, a copy is entered into the table.
+char* GPNode::internString (char* str)
 {
-  char *s=new char[strlen (str)+1];
-  strcpy (s, str);
-  return s;
+  unsigned long h=0;
+  for (char* p=str; *p; p++)
+    h=h*31+(unsigned char) *p;
+  GPInternedString** bucket=&internTable[h%internBuckets];
+
+  for (GPInternedString* e=*bucket; e; e=e->next)
+    if (strcmp (e->str, str)==0)
+      return e->str;
+
+  GPInternedString* e=new GPInternedString;
+  e->str=new char[strlen (str)+1];
+  strcpy (e->str, str);
+  e->next=*bucket;
+  *bucket=e;
+  return e->str;
 }
 
 
@@ -82,6 +147,9 @@ char* GPNode::load (istream& is)
 {
   char line[400];
 
+  if (shareCount)
+    return "Node is shared and can't be loaded";
+
   is >> nodeValue;
   is >> numOfArgs;
 
@@ -105,9 +173,7 @@ char* GPNode::load (istream& is)
   while (line[ix-1]!='"');
   line[ix-1]='\0';
 
-  if (representation)
-    delete [] representation;
-  representation=copyString (line);
+  representation=internString (line);
   return NULL;
 }
 
@@ -123,6 +189,52 @@ void GPNode::save (ostream& os)
 
 
 
+// Copy constructor.  The copy shares the nodes.
+GPNodeSet::GPNodeSet (const GPNodeSet& gpo) : 
+  GPContainer (gpo.containerSize ())
+{
+  numFunctions=gpo.numFunctions;
+  numTerminals=gpo.numTerminals;
+  shareCount=0;
+  pure=gpo.pure;
+  for (int n=0; n<containerSize (); n++)
+    if (gpo.container[n])
+      container[n]=((GPNode*) gpo.container[n])->share ();
+
+  primitive=NULL;
+  if (gpo.primitive)
+    {
+      primitive=new GPInstruction[containerSize ()];
+      memcpy (primitive, gpo.primitive, 
+	      containerSize ()*sizeof (GPInstruction));
+    }
+
+  source=NULL;
+  if (gpo.source)
+    {
+      source=new char*[containerSize ()];
+      memcpy (source, gpo.source, containerSize ()*sizeof (char*));
+    }
+}
+
+
+
+// Destructor.  The nodes are released, the ones that are not shared
+// any more are deleted.
+GPNodeSet::~GPNodeSet ()
+{
+  delete [] primitive;
+  delete [] source;
+  for (int n=0; n<containerSize (); n++)
+    if (container[n])
+      {
+	GPNode::release ((GPNode*) container[n]);
+	container[n]=NULL;
+      }
+}
+
+
+
 // We inherit this function because the user must not put anything in
 // our container by hand.
 void GPNodeSet::put (int, GPObject&)
@@ -133,9 +245,24 @@ void GPNodeSet::put (int, GPObject&)
 
 
 
+// Declares the node set pure (or not, see the comment in gp.h)
+void GPNodeSet::setPure (int pure_)
+{
+  if (shareCount)
+    GPExitSystem ("GPNodeSet::setPure", 
+		  "Node set is shared and can't be changed");
+  pure=pure_;
+}
+
+
+
 // Put a node in the container.  
 void GPNodeSet::putNode (GPNode& gpo)
 {
+  if (shareCount)
+    GPExitSystem ("GPNodeSet::putNode", 
+		  "Node set is shared and can't be changed");
+
 #if GPINTERNALCHECK
   // Check if full
   if (numFunctions+numTerminals==containerSize())
@@ -176,7 +303,7 @@ GPNode* GPNodeSet::chooseNodeWithArgs (int args)
     return NULL;
 
   // Choose one
-  int k=GPrand() % num;
+  int k=GPRandomBelow (num);
 
   // Return the node with chosen index
   for (i=0, num=0; i<containerSize(); i++)
@@ -204,7 +331,7 @@ GPNode& GPNodeSet::chooseFunction ()
 		  "No function to choose from"); 
 #endif
 
-  return *NthNode (GPrand() % numFunctions);
+  return *NthNode (GPRandomBelow (numFunctions));
 }
 
 
@@ -218,7 +345,8 @@ GPNode& GPNodeSet::chooseTerminal ()
 		  "No terminal to choose from"); 
 #endif
 
-  return *NthNode (containerSize()-numTerminals+GPrand() % numTerminals);
+  return *NthNode (containerSize()-numTerminals
+		   +GPRandomBelow (numTerminals));
 }
 
 
@@ -265,9 +393,26 @@ GPNode* GPNodeSet::searchForNode (int value)
 
 
 
+// Return the index of the given node within the container, or -1 if
+// the node is not part of the node set
+int GPNodeSet::indexOfNode (GPNode* gpo)
+{
+  for (int n=0; n<containerSize(); n++)
+    if (NthNode (n)==gpo)
+      return n;
+
+  // Not found
+  return -1;
+}
+
+
+
 // Load operation
 char* GPNodeSet::load (istream& is)
 {
+  if (shareCount)
+    return "Node set is shared and can't be loaded";
+
   is >> numFunctions;
   is >> numTerminals;
 
@@ -313,3 +458,68 @@ void GPAdfNodeSet::printOn (ostream& os)
 
 
 
+
+
+
+// Copy constructor.  The copy shares the node sets.
+GPAdfNodeSet::GPAdfNodeSet (const GPAdfNodeSet& gpo) : 
+  GPContainer (gpo.containerSize ())
+{
+  shareCount=0;
+  for (int n=0; n<containerSize (); n++)
+    if (gpo.container[n])
+      container[n]=((GPNodeSet*) gpo.container[n])->share ();
+}
+
+
+
+// Destructor.  The node sets are released, the ones that are not
+// shared any more are deleted.
+GPAdfNodeSet::~GPAdfNodeSet ()
+{
+  for (int n=0; n<containerSize (); n++)
+    if (container[n])
+      {
+	GPNodeSet::release ((GPNodeSet*) container[n]);
+	container[n]=NULL;
+      }
+}
+
+
+
+// An ADF node set is pure, if all its node sets are
+int GPAdfNodeSet::isPure ()
+{
+  for (int n=0; n<containerSize (); n++)
+    if (!NthNodeSet (n) || !NthNodeSet (n)->isPure ())
+      return 0;
+  return 1;
+}
+
+
+
+// Put a node set into the container.  Only allowed as long as the
+// ADF node set is not shared.  A node set that was there before is
+// released.
+void GPAdfNodeSet::put (int n, GPObject& gpo)
+{
+  if (shareCount)
+    GPExitSystem ("GPAdfNodeSet::put", 
+		  "ADF node set is shared and can't be changed");
+  if (Nth (n))
+    {
+      GPNodeSet::release (NthNodeSet (n));
+      container[n]=NULL;
+    }
+  GPContainer::put (n, gpo);
+}
+
+
+
+// Load operation
+char* GPAdfNodeSet::load (istream& is)
+{
+  if (shareCount)
+    return "ADF node set is shared and can't be loaded";
+  return GPContainer::load (is);
+}
@@ -51,6 +51,96 @@ Fax:    (UK) 061 745 5999
 
 using namespace std;
 
+// Destructor.  The members are deleted by clear().
+GPPopulation::~GPPopulation ()
+{
+  clear ();
+  if (fitnessTable)
+    delete fitnessTable;
+  if (resultCache)
+    delete resultCache;
+  if (threadPool)
+    delete threadPool;
+  if (arena)
+    delete arena;
+  if (store)
+    delete store;
+  if (adfNs)
+    GPAdfNodeSet::release (adfNs);
+}
+
+
+
+// Deletes all members of the population, so that it can be used
+// again as the new population of generate() (GPVariables parameter
+// Recycling).  If the members were allocated from an arena, we don't
+// delete them one by one, but give back the arena as a whole.  Only
+// members that don't come from the arena (the user might have put
+// them into the population) are deleted the usual way.  The compiled
+// code of the others comes from the heap and is deleted on its own.  If
+// Recycling is set, the arena is kept for the next generation.  The
+// gene table gives back its references to the genes, and the store
+// (GPVariables parameter OutOfCore) forgets its demes.
+void GPPopulation::clear ()
+{
+  if (store)
+    if (GPVar.Recycling)
+      store->reset ();
+    else
+      {
+	delete store;
+	store=NULL;
+      }
+  bestOfPopulation=-1;
+  worstOfPopulation=-1;
+
+  if (geneTable)
+    {
+      delete geneTable;
+      geneTable=NULL;
+    }
+
+  if (arena)
+    {
+      for (int n=0; n<containerSize(); n++)
+	if (container[n])
+	  {
+	    if (GPArena::owner (container[n])!=arena)
+	      delete container[n];
+	    else
+	      NthGP (n)->releaseCode ();
+	    container[n]=NULL;
+	  }
+      deleteContainer ();
+      if (GPVar.Recycling)
+	arena->reset ();
+      else
+	{
+	  delete arena;
+	  arena=NULL;
+	}
+    }
+  else
+    deleteContainer ();
+  contSize=0;
+}
+
+
+
+// The random stream for the individual with the given number (its
+// index in the population) of this generation.  The number is split
+// into the deme and the number in the deme, if demetic grouping is
+// used.
+GPRandomGenerator* GPPopulation::randomStream (int number, GPRandomUse use)
+{
+  if (GPVar.DemeticGrouping && GPVar.DemeSize>0)
+    return createRandomStream (generationNumber, number/GPVar.DemeSize, 
+			       number%GPVar.DemeSize, use);
+  return createRandomStream (generationNumber, 0, number, use);
+}
+
+
+
 // Prints out the complete population
 void GPPopulation::printOn (ostream& os)
 {
@@ -111,6 +201,14 @@ void GPPopulation::createGenerationReport (int printLegend, int generation,
        << ")" << endl 
        << *NthGP (bestOfPopulation)
        << endl;
+
+  // How busy the threads were since the last report
+  if (threadPool)
+    {
+      threadPool->printStatistics (fout);
+      fout << endl;
+      threadPool->resetStatistics ();
+    }
 }
 
 
@@ -168,6 +266,9 @@ long GPPopulation::totalDepth()
 void GPPopulation::setNodeSets (GPAdfNodeSet& adfNs_)
 {
   // Set object variable
+  adfNs_.share ();
+  if (adfNs)
+    GPAdfNodeSet::release (adfNs);
   adfNs=&adfNs_;
 
   // Every GP has to be informed about the new node sets.  Most
@@ -184,8 +184,8 @@ void GPPopulation::tournamentSelection (int *selection, int numToSelect,
 
   // We randomly select a few members from the given index range and
   // put the indices into the tournament array.
-  for (i=0; i<GPVar.TournamentSize; i++)
-    tourn[i]=range.startIx + GPrand () % (range.endIx-range.startIx);
+  GPRandomIndices (&tourn[0], GPVar.TournamentSize, range.startIx, 
+		   range.endIx-range.startIx);
 
   // Now we look for the two best/worst ones, which become the
   // parents.  Well, perhaps we need only one
@@ -284,12 +284,8 @@ void GPPopulation::probabilisticSelection (int *selection, int numToSelect,
   // We select as much members as the user wants (usually 1 or 2)
   for (int n=0; n<numToSelect; n++)
     {
-      // Get random number between 0 and a high value.  The higher the
-      // value, the better the resolution.  Be careful what numbers
-      // the random generator gives us! (The new random generator
-      // doesn't have the problems the old one had)
-      const long highValue=300000l;
-      double rand=(double) (GPrand() % highValue);
+      // Get random number between 0 and 1
+      double rand=GPRandomUniform ();
 
       // Loop through population, summing up the fitness/inversed
       // fitness.  As we are using standardized fitness, we sum up
@@ -300,8 +296,7 @@ void GPPopulation::probabilisticSelection (int *selection, int numToSelect,
       if (selectWorst)
 	{
 	  double sum=0.0;
-	  double lookingForFit=rand / (double)(highValue-1l) 
-	    * sumFitness;
+	  double lookingForFit=rand * sumFitness;
 	  for (i=range.startIx; i<range.endIx; i++)
 	    {
 	      sum+=NthGP (i)->stdFitness;
@@ -312,8 +307,7 @@ void GPPopulation::probabilisticSelection (int *selection, int numToSelect,
       else
 	{
 	  double sumInv=0.0;
-	  double lookingForInvFit=rand / (double)(highValue-1l) 
-	    * invSumFitness;
+	  double lookingForInvFit=rand * invSumFitness;
 	  for (i=range.startIx; i<range.endIx; i++)
 	    {
 	      sumInv+=inverse (NthGP (i)->stdFitness);
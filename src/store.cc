@@ -0,0 +1,483 @@
+
+// store.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// Out-of-core storage of a population (GPVariables parameter
+// OutOfCore).  The members are kept in a memory-mapped temporary file
+// in a compact binary form and only the deme generate() is working
+// on is paged in as GP objects.
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "gp.h"
+
+
+
+// Each member of a deme starts with this record, followed by the
+// data GP::pack() writes.  The record contains everything
+// calculateStatistics() needs, so the statistics are calculated
+// without unpacking the members.  Records are aligned to 8 bytes.  As
+// everywhere in the kernel, every GP has as many trees as there are
+// node sets.
+struct GPDemeRecord
+{
+  double stdFitness;
+  int fitnessValid;
+  int length, depth;
+  int size;
+};
+
+// The file grows by this size at least
+const long storeMinimumGrowth=1048576;
+
+
+
+// Creates the temporary file.  It is removed from the directory at
+// once, so it disappears when the store is deleted (or the program
+// terminates).  The directory is taken from the environment variable
+// TMPDIR, /tmp is the default.
+GPDemeStore::GPDemeStore ()
+{
+  const char* dir=getenv ("TMPDIR");
+  if (!dir || !*dir)
+    dir="/tmp";
+  char* name=new char[strlen (dir)+20];
+  strcpy (name, dir);
+  strcat (name, "/gpdemesXXXXXX");
+  fd=mkstemp (name);
+  if (fd<0)
+    GPExitSystem ("GPDemeStore::GPDemeStore", 
+		  "Can't create temporary file");
+  unlink (name);
+  delete [] name;
+
+  map=NULL;
+  mapSize=0;
+  used=0;
+  demeOffset=NULL;
+  demeSize=NULL;
+  numDemes=0;
+  currentDeme=-1;
+}
+
+
+
+GPDemeStore::~GPDemeStore ()
+{
+  if (map)
+    munmap (map, mapSize);
+  close (fd);
+  delete [] demeOffset;
+  delete [] demeSize;
+}
+
+
+
+// Makes the file and the mapping big enough for size more bytes.  The
+// mapping may move, so pointers into it become invalid.
+void GPDemeStore::grow (long size)
+{
+  if (used+size<=mapSize)
+    return;
+
+  long newSize=mapSize*2;
+  if (newSize<used+size+storeMinimumGrowth)
+    newSize=used+size+storeMinimumGrowth;
+  long page=sysconf (_SC_PAGESIZE);
+  newSize=(newSize+page-1)/page*page;
+
+  if (map)
+    munmap (map, mapSize);
+  if (ftruncate (fd, newSize)<0)
+    GPExitSystem ("GPDemeStore::grow", "Can't enlarge temporary file");
+  map=(char*) mmap (NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, 
+		    fd, 0);
+  if (map==(char*) MAP_FAILED)
+    GPExitSystem ("GPDemeStore::grow", "Can't map temporary file");
+  mapSize=newSize;
+}
+
+
+
+// Starts writing a deme.  A deme that was written before is replaced
+// (its space is only reused after reset()).
+void GPDemeStore::startDeme (int deme)
+{
+#if GPINTERNALCHECK
+  if (currentDeme>=0)
+    GPExitSystem ("GPDemeStore::startDeme", "Deme not finished");
+#endif
+
+  if (deme>=numDemes)
+    {
+      int newNum=numDemes ? numDemes*2 : 16;
+      while (newNum<=deme)
+	newNum*=2;
+      long* newOffset=new long[newNum];
+      long* newSize=new long[newNum];
+      for (int n=0; n<newNum; n++)
+	if (n<numDemes)
+	  {
+	    newOffset[n]=demeOffset[n];
+	    newSize[n]=demeSize[n];
+	  }
+	else
+	  {
+	    newOffset[n]=-1;
+	    newSize[n]=0;
+	  }
+      delete [] demeOffset;
+      delete [] demeSize;
+      demeOffset=newOffset;
+      demeSize=newSize;
+      numDemes=newNum;
+    }
+
+  currentDeme=deme;
+  demeOffset[deme]=used;
+}
+
+
+
+// Returns a pointer to size bytes at the end of the deme that is
+// being written.  The pointer is valid until the next call.
+char* GPDemeStore::append (long size)
+{
+#if GPINTERNALCHECK
+  if (currentDeme<0)
+    GPExitSystem ("GPDemeStore::append", "No deme started");
+#endif
+
+  grow (size);
+  char* p=map+used;
+  used+=size;
+  return p;
+}
+
+
+
+void GPDemeStore::write (const void* data, long size)
+{
+  memcpy (append (size), data, size);
+}
+
+
+
+void GPDemeStore::endDeme ()
+{
+  demeSize[currentDeme]=used-demeOffset[currentDeme];
+  release (currentDeme);
+  currentDeme=-1;
+}
+
+
+
+// Returns the data of a deme, or NULL, if the deme wasn't written
+// yet.
+char* GPDemeStore::NthDeme (int deme)
+{
+  if (deme>=numDemes || demeOffset[deme]<0)
+    return NULL;
+  return map+demeOffset[deme];
+}
+
+
+
+// The pages of the deme are dropped from the address space of the
+// process.  The data is not lost, as the mapping is shared with the
+// file: the kernel writes dirty pages back and reads them again when
+// they are accessed the next time.
+void GPDemeStore::release (int deme)
+{
+  if (deme>=numDemes || demeOffset[deme]<0 || !demeSize[deme])
+    return;
+
+  long page=sysconf (_SC_PAGESIZE);
+  long start=demeOffset[deme]/page*page;
+  long end=demeOffset[deme]+demeSize[deme];
+  msync (map+start, end-start, MS_ASYNC);
+  madvise (map+start, end-start, MADV_DONTNEED);
+}
+
+
+
+// Forget all demes.  The file keeps its size, the data is
+// overwritten by the next demes.
+void GPDemeStore::reset ()
+{
+  for (int n=0; n<numDemes; n++)
+    {
+      demeOffset[n]=-1;
+      demeSize[n]=0;
+    }
+  used=0;
+  currentDeme=-1;
+}
+
+
+
+// Packs the trees of a genetic program: for each tree its length and
+// the indices of its nodes within the node set in prefix order.
+static void packGene (GPGene& g, GPNodeSet& ns, unsigned short*& p)
+{
+  int ix=ns.indexOfNode (&g.geneNode ());
+#if GPINTERNALCHECK
+  if (ix<0)
+    GPExitSystem ("GP::pack", "Node not in node set");
+#endif
+  *p++=(unsigned short) ix;
+  for (int n=0; n<g.containerSize (); n++)
+    packGene (*g.NthChild (n), ns, p);
+}
+
+void GP::pack (GPDemeStore& store, GPAdfNodeSet& adfNs)
+{
+  for (int n=0; n<containerSize (); n++)
+    {
+      GPGene* g=NthGene (n);
+      int length=g ? g->length () : 0;
+      store.write (&length, sizeof (int));
+      if (g)
+	{
+	  unsigned short* p=(unsigned short*) 
+	    store.append (length*sizeof (unsigned short));
+	  packGene (*g, *adfNs.NthNodeSet (n), p);
+	}
+    }
+}
+
+
+
+// Rebuilds the trees written by pack().  The genes are created with
+// createGene() and createChild() as usual.
+static void unpackGene (GPGene& g, GPNodeSet& ns, unsigned short*& p)
+{
+  for (int n=0; n<g.containerSize (); n++)
+    {
+      GPGene* child=g.createChild (*ns.NthNode (*p++));
+      g.put (n, *child);
+      unpackGene (*child, ns, p);
+    }
+}
+
+void GP::unpack (char*& data, GPAdfNodeSet& adfNs)
+{
+  for (int n=0; n<containerSize (); n++)
+    {
+      int length;
+      memcpy (&length, data, sizeof (int));
+      data+=sizeof (int);
+      if (length)
+	{
+	  GPNodeSet& ns=*adfNs.NthNodeSet (n);
+	  unsigned short* p=(unsigned short*) data;
+	  GPGene* g=createGene (*ns.NthNode (*p++));
+	  put (n, *g);
+	  unpackGene (*g, ns, p);
+	  data+=length*sizeof (unsigned short);
+	}
+    }
+
+  calcLength ();
+  calcDepth ();
+}
+
+
+
+// Writes the members of a deme to the store, if writeBack is set, and
+// deletes them.  The best and worst of the population are kept in
+// memory, because the user might want to have a look at them.
+void GPPopulation::pageOut (int deme, int writeBack)
+{
+  int startIx=deme*GPVar.DemeSize;
+  int endIx=startIx+GPVar.DemeSize;
+
+  if (writeBack)
+    {
+      store->startDeme (deme);
+      for (int n=startIx; n<endIx; n++)
+	{
+	  GP* current=NthGP (n);
+#if GPINTERNALCHECK
+	  if (!current)
+	    GPExitSystem ("GPPopulation::pageOut", "GP is NULL");
+#endif
+	  GPDemeRecord r;
+	  r.stdFitness=current->stdFitness;
+	  r.fitnessValid=current->fitnessValid;
+	  r.length=current->length ();
+	  r.depth=current->depth ();
+
+	  long pos=store->position ();
+	  store->write (&r, sizeof (r));
+	  current->pack (*store, *adfNs);
+	  long size=store->position ()-pos;
+	  if (size%8)
+	    store->append (8-size%8);
+	  ((GPDemeRecord*) store->at (pos))->size=
+	    (int) (store->position ()-pos);
+	}
+      store->endDeme ();
+    }
+
+  for (int n=startIx; n<endIx; n++)
+    if (n!=bestOfPopulation && n!=worstOfPopulation && container[n])
+      {
+	delete container[n];
+	container[n]=NULL;
+      }
+}
+
+
+
+// Unpacks the members of a deme from the store.  Members that are
+// still in memory are not unpacked again.
+void GPPopulation::pageIn (int deme)
+{
+  char* data=store->NthDeme (deme);
+  if (!data)
+    GPExitSystem ("GPPopulation::pageIn", "Deme not in store");
+
+  int startIx=deme*GPVar.DemeSize;
+  for (int n=startIx; n<startIx+GPVar.DemeSize; n++)
+    {
+      GPDemeRecord r;
+      memcpy (&r, data, sizeof (r));
+      if (!container[n])
+	{
+	  GP* gp=createGP (adfNs->containerSize ());
+	  char* p=data+sizeof (r);
+	  gp->unpack (p, *adfNs);
+	  gp->stdFitness=r.stdFitness;
+	  gp->fitnessValid=r.fitnessValid;
+	  put (n, *gp);
+	}
+      data+=r.size;
+    }
+  store->release (deme);
+}
+
+
+
+// The statistics of a population that is kept in the store.  All
+// demes must have been paged out.  The values are taken from the
+// records of the members, in the same order calculateStatistics()
+// would visit them, so the results are exactly the same.  Afterwards,
+// the best and the worst of the population are unpacked and stay in
+// memory; the ones that were kept before are deleted.
+void GPPopulation::storedStatistics ()
+{
+  double sumFitness=0.0;
+  long sumLength=0, sumDepth=0;
+  double bestFitness=0.0, worstFitness=0.0;
+  int bestLength=0, worstLength=0;
+  int numDemes=containerSize ()/GPVar.DemeSize;
+  long bestPos=0, worstPos=0;
+
+  for (int deme=0; deme<numDemes; deme++)
+    {
+      char* data=store->NthDeme (deme);
+      if (!data)
+	GPExitSystem ("GPPopulation::calculateStatistics", 
+		      "Deme not in store");
+      int startIx=deme*GPVar.DemeSize;
+      for (int n=startIx; n<startIx+GPVar.DemeSize; n++)
+	{
+	  GPDemeRecord r;
+	  memcpy (&r, data, sizeof (r));
+	  sumFitness+=r.stdFitness;
+	  sumLength+=r.length;
+	  sumDepth+=r.depth;
+
+	  if (n==0 
+	      || worstFitness < r.stdFitness 
+	      || (worstFitness == r.stdFitness && worstLength < r.length))
+	    {
+	      worstOfPopulation=n;
+	      worstFitness=r.stdFitness;
+	      worstLength=r.length;
+	      worstPos=data-store->at (0);
+	    }
+	  if (n==0 
+	      || bestFitness > r.stdFitness 
+	      || (bestFitness == r.stdFitness && bestLength > r.length))
+	    {
+	      bestOfPopulation=n;
+	      bestFitness=r.stdFitness;
+	      bestLength=r.length;
+	      bestPos=data-store->at (0);
+	    }
+	  data+=r.size;
+	}
+      store->release (deme);
+    }
+
+  avgFitness=sumFitness / (double) containerSize ();
+  avgLength=(double) sumLength / (double) containerSize ();
+  avgDepth=(double) sumDepth / (double) containerSize ();
+
+  // Only the best and worst stay in memory
+  for (int n=0; n<containerSize (); n++)
+    if (container[n] && n!=bestOfPopulation && n!=worstOfPopulation)
+      {
+	delete container[n];
+	container[n]=NULL;
+      }
+  int ix[2]={ bestOfPopulation, worstOfPopulation };
+  long pos[2]={ bestPos, worstPos };
+  for (int i=0; i<2; i++)
+    if (!container[ix[i]])
+      {
+	GPDemeRecord r;
+	memcpy (&r, store->at (pos[i]), sizeof (r));
+	GP* gp=createGP (adfNs->containerSize ());
+	char* p=store->at (pos[i])+sizeof (r);
+	gp->unpack (p, *adfNs);
+	gp->stdFitness=r.stdFitness;
+	gp->fitnessValid=r.fitnessValid;
+	put (ix[i], *gp);
+      }
+}
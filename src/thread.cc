@@ -0,0 +1,543 @@
+
+// thread.cc
+
+/* -------------------------------------------------------------------
+
+gpc++ - The Genetic Programming Kernel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 1, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+
+Copyright 1993, 1994 Adam P. Fraser and 1996, 1997 Thomas Weinbrenner
+
+For comments, improvements, additions (or even money) contact:
+
+Thomas Weinbrenner
+Grauensteinstr. 26
+35789 Laimbach
+Germany
+E-mail: thomasw@emk.e-technik.th-darmstadt.de
+WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
+
+  or 
+
+(Address may be out of date)
+Adam Fraser, Postgraduate Section, Dept of Elec & Elec Eng,
+Maxwell Building, University Of Salford, Salford, M5 4WT, United Kingdom.
+E-mail: a.fraser@eee.salford.ac.uk
+Tel:    (UK) 061 745 5000 x3633
+Fax:    (UK) 061 745 5999
+
+------------------------------------------------------------------- */
+
+// A pool of threads for the evaluation of a population (see class
+// GPThreadPool).  The threads wait for a new round of work on a
+// condition variable; then each one works on its own queue, and
+// steals from the queues of the others when it is empty.  A thread
+// that finds no work spins for a short while, then sleeps until
+// there is new work or the round is over.
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if GPTHREADS
+#include <sched.h>
+#endif
+#include "gp.h"
+
+using namespace std;
+
+// The number of times an idle thread looks for work before it sleeps
+static const int spinRounds=100;
+
+// The pool the thread works for, and its number in the pool
+GPThreadLocal GPThreadPool* GPThreadPool::currentPool=NULL;
+GPThreadLocal int GPThreadPool::currentThread=0;
+
+
+
+double GPTime ()
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+
+
+// Constructor.  A number of threads below 1 means one per
+// processor.  The calling thread counts as one, so one less is
+// started.
+GPThreadPool::GPThreadPool (int numThreads_)
+{
+  numThreads=numThreads_;
+#if GPTHREADS
+  if (numThreads<1)
+    numThreads=(int) sysconf (_SC_NPROCESSORS_ONLN);
+  if (numThreads<1)
+    numThreads=1;
+
+  pthread_mutex_init (&mutex, NULL);
+  pthread_cond_init (&started, NULL);
+  pthread_cond_init (&finished, NULL);
+  pthread_cond_init (&wakeup, NULL);
+  remaining=0;
+  busy=0;
+  stop=0;
+  round=0;
+  pushes=0;
+  firstIdle=0.0;
+
+  workers=new Worker[numThreads];
+  for (int n=0; n<numThreads; n++)
+    {
+      Worker& w=workers[n];
+      pthread_mutex_init (&w.lock, NULL);
+      w.pool=this;
+      w.size=64;
+      w.entry=new Entry[w.size];
+      w.head=0;
+      w.tail=0;
+      w.nested=0.0;
+    }
+  resetStatistics ();
+
+  thread=new pthread_t[numThreads];
+  for (int n=1; n<numThreads; n++)
+    if (pthread_create (&thread[n], NULL, worker, &workers[n]))
+      GPExitSystem ("GPThreadPool::GPThreadPool", 
+		    "Can't create thread");
+#else
+  numThreads=1;
+  resetStatistics ();
+#endif
+}
+
+
+
+// Destructor.  The threads are told to stop and waited for.
+GPThreadPool::~GPThreadPool ()
+{
+#if GPTHREADS
+  pthread_mutex_lock (&mutex);
+  stop=1;
+  pthread_cond_broadcast (&started);
+  pthread_mutex_unlock (&mutex);
+  for (int n=1; n<numThreads; n++)
+    pthread_join (thread[n], NULL);
+  delete [] thread;
+
+  for (int n=0; n<numThreads; n++)
+    {
+      pthread_mutex_destroy (&workers[n].lock);
+      delete [] workers[n].entry;
+    }
+  delete [] workers;
+
+  pthread_cond_destroy (&wakeup);
+  pthread_cond_destroy (&finished);
+  pthread_cond_destroy (&started);
+  pthread_mutex_destroy (&mutex);
+#endif
+}
+
+
+
+void GPThreadPool::resetStatistics ()
+{
+  rounds=0;
+  wall=0.0;
+  tail=0.0;
+#if GPTHREADS
+  for (int n=0; n<numThreads; n++)
+    {
+      workers[n].items=0;
+      workers[n].stolen=0;
+      workers[n].busy=0.0;
+    }
+#endif
+}
+
+
+
+// Prints how busy the threads were since the statistics were reset
+void GPThreadPool::printStatistics (ostream& os)
+{
+  os << "Threads: " << numThreads << ", " << rounds << " rounds in " 
+     << wall << " s, idle threads at the end of them for " << tail 
+     << " s" << endl;
+#if GPTHREADS
+  double total=0.0;
+  for (int n=0; n<numThreads; n++)
+    {
+      Worker& w=workers[n];
+      total+=w.busy;
+      os << "  Thread " << n << ": " << w.items << " items (" 
+	 << w.stolen << " stolen), busy " << w.busy << " s (" 
+	 << (wall>0.0 ? 100.0*w.busy/wall : 0.0) << "%)" << endl;
+    }
+  os << "  Utilisation: " 
+     << (wall>0.0 ? 100.0*total/(wall*numThreads) : 0.0) << "%" << endl;
+#endif
+}
+
+
+
+#if GPTHREADS
+// Puts an entry at the tail of the queue of a thread.  If the queue
+// is full, it is moved to the front or enlarged.
+void GPThreadPool::push (int w, Entry& e)
+{
+  Worker& me=workers[w];
+  pthread_mutex_lock (&me.lock);
+  if (me.tail==me.size)
+    {
+      if (me.head>0)
+	{
+	  memmove (me.entry, me.entry+me.head, 
+		   (me.tail-me.head)*sizeof (Entry));
+	  me.tail-=me.head;
+	  me.head=0;
+	}
+      else
+	{
+	  Entry* tmp=new Entry[me.size*2];
+	  memcpy (tmp, me.entry, me.size*sizeof (Entry));
+	  delete [] me.entry;
+	  me.entry=tmp;
+	  me.size*=2;
+	}
+    }
+  me.entry[me.tail++]=e;
+  pthread_mutex_unlock (&me.lock);
+}
+
+
+
+// Takes an entry from the tail of the own queue, or steals one from
+// the head of the queue of another thread.  Returns 0 if there is
+// none.
+int GPThreadPool::take (int w, Entry& e)
+{
+  for (int n=0; n<numThreads; n++)
+    {
+      Worker& victim=workers[(w+n)%numThreads];
+      pthread_mutex_lock (&victim.lock);
+      if (victim.tail>victim.head)
+	{
+	  e=n ? victim.entry[victim.head++] : victim.entry[--victim.tail];
+	  if (victim.head==victim.tail)
+	    {
+	      victim.head=0;
+	      victim.tail=0;
+	    }
+	  pthread_mutex_unlock (&victim.lock);
+	  if (n)
+	    workers[w].stolen++;
+	  return 1;
+	}
+      pthread_mutex_unlock (&victim.lock);
+    }
+  return 0;
+}
+
+
+
+// Runs an entry and counts it as done.  The time of entries that are
+// run within a fork() of this one is not counted twice.
+void GPThreadPool::execute (int w, Entry& e)
+{
+  Worker& me=workers[w];
+  double outer=me.nested;
+  me.nested=0.0;
+  double start=GPTime ();
+  e.task->run (e.item);
+  double time=GPTime ()-start;
+  me.busy+=time-me.nested;
+  me.items++;
+  me.nested=outer+time;
+
+  pthread_mutex_lock (&mutex);
+  if (e.pending ? --*e.pending==0 : --remaining==0)
+    pthread_cond_broadcast (&wakeup);
+  pthread_mutex_unlock (&mutex);
+}
+
+
+
+// Reads a counter that is changed by other threads
+int GPThreadPool::count (int* counter)
+{
+  pthread_mutex_lock (&mutex);
+  int value=*counter;
+  pthread_mutex_unlock (&mutex);
+  return value;
+}
+
+
+
+// Tells the sleeping threads that entries were pushed
+void GPThreadPool::wake ()
+{
+  pthread_mutex_lock (&mutex);
+  pushes++;
+  pthread_cond_broadcast (&wakeup);
+  pthread_mutex_unlock (&mutex);
+}
+
+
+
+// Takes an entry for thread w like take(), or, if there is none,
+// waits until there is one or the counter (remaining, or the items of
+// a fork() that are not done) is 0; then it returns 0.  The thread
+// spins for a while before it sleeps.  The number of pushes is read
+// before the queues are searched for the last time, so an entry that
+// is pushed after that wakes the thread.
+int GPThreadPool::waitForWork (int w, int* counter, Entry& e)
+{
+  for (int spin=0; spin<spinRounds; spin++)
+    {
+      if (take (w, e))
+	return 1;
+      if (!count (counter))
+	return 0;
+      sched_yield ();
+    }
+
+  pthread_mutex_lock (&mutex);
+  while (*counter)
+    {
+      long seen=pushes;
+      pthread_mutex_unlock (&mutex);
+      if (take (w, e))
+	return 1;
+      pthread_mutex_lock (&mutex);
+      while (pushes==seen && *counter)
+	pthread_cond_wait (&wakeup, &mutex);
+    }
+  pthread_mutex_unlock (&mutex);
+  return 0;
+}
+
+
+
+// Works on the current round until all its items are done
+void GPThreadPool::work (int w)
+{
+  GPThreadPool* previousPool=currentPool;
+  int previousThread=currentThread;
+  currentPool=this;
+  currentThread=w;
+
+  int idle=0;
+  Entry e;
+  for (;;)
+    {
+      if (!take (w, e))
+	{
+	  if (!idle)
+	    {
+	      idle=1;
+	      pthread_mutex_lock (&mutex);
+	      if (firstIdle==0.0)
+		firstIdle=GPTime ();
+	      pthread_mutex_unlock (&mutex);
+	    }
+	  if (!waitForWork (w, &remaining, e))
+	    break;
+	}
+      execute (w, e);
+    }
+
+  currentPool=previousPool;
+  currentThread=previousThread;
+}
+
+
+
+// The threads of the pool wait for the next round, work on it and
+// tell the last one that finishes.
+void* GPThreadPool::worker (void* arg)
+{
+  Worker& me=*(Worker*) arg;
+  GPThreadPool& p=*me.pool;
+  int w=&me-p.workers;
+  long seen=0;
+
+  pthread_mutex_lock (&p.mutex);
+  for (;;)
+    {
+      while (p.round==seen && !p.stop)
+	pthread_cond_wait (&p.started, &p.mutex);
+      if (p.stop)
+	break;
+      seen=p.round;
+      pthread_mutex_unlock (&p.mutex);
+
+      p.work (w);
+
+      pthread_mutex_lock (&p.mutex);
+      if (--p.busy==0)
+	pthread_cond_signal (&p.finished);
+    }
+  pthread_mutex_unlock (&p.mutex);
+  return NULL;
+}
+
+
+
+// The items and their costs, for sorting them with qsort()
+struct GPCostItem
+{
+  double cost;
+  int item;
+};
+
+static int compareCost (const void* a, const void* b)
+{
+  double ca=((GPCostItem*) a)->cost, cb=((GPCostItem*) b)->cost;
+  return ca>cb ? -1 : ca<cb ? 1 : 0;
+}
+#endif
+
+
+
+void GPThreadPool::run (GPTask& task, int numItems, const double* cost)
+{
+  double start=GPTime ();
+  rounds++;
+
+#if GPTHREADS
+  // Deal the items out to the queues.  With costs, each item goes to
+  // the thread with the least work so far, from the most expensive to
+  // the cheapest.  The queues are filled so that each thread takes
+  // its most expensive item first.
+  Entry e;
+  e.task=&task;
+  e.pending=NULL;
+  if (cost)
+    {
+      GPCostItem* order=new GPCostItem[numItems];
+      for (int n=0; n<numItems; n++)
+	{
+	  order[n].cost=cost[n];
+	  order[n].item=n;
+	}
+      qsort (order, numItems, sizeof (GPCostItem), compareCost);
+
+      int* owner=new int[numItems];
+      double* load=new double[numThreads];
+      for (int w=0; w<numThreads; w++)
+	load[w]=0.0;
+      for (int n=0; n<numItems; n++)
+	{
+	  int least=0;
+	  for (int w=1; w<numThreads; w++)
+	    if (load[w]<load[least])
+	      least=w;
+	  owner[n]=least;
+	  load[least]+=order[n].cost;
+	}
+      for (int n=numItems-1; n>=0; n--)
+	{
+	  e.item=order[n].item;
+	  push (owner[n], e);
+	}
+      delete [] order;
+      delete [] owner;
+      delete [] load;
+    }
+  else
+    for (int w=0; w<numThreads; w++)
+      for (int n=(int) ((long) (w+1)*numItems/numThreads)-1; 
+	   n>=(int) ((long) w*numItems/numThreads); n--)
+	{
+	  e.item=n;
+	  push (w, e);
+	}
+
+  pthread_mutex_lock (&mutex);
+  remaining=numItems;
+  firstIdle=0.0;
+  if (numThreads>1)
+    {
+      busy=numThreads-1;
+      round++;
+      pthread_cond_broadcast (&started);
+    }
+  pthread_mutex_unlock (&mutex);
+
+  work (0);
+
+  pthread_mutex_lock (&mutex);
+  while (busy)
+    pthread_cond_wait (&finished, &mutex);
+  pthread_mutex_unlock (&mutex);
+
+  double end=GPTime ();
+  if (firstIdle>0.0)
+    tail+=end-firstIdle;
+  wall+=end-start;
+#else
+  for (int n=0; n<numItems; n++)
+    task.run (n);
+  wall+=GPTime ()-start;
+#endif
+}
+
+
+
+void GPThreadPool::fork (GPTask& task, int numItems)
+{
+#if GPTHREADS
+  GPThreadPool* p=currentPool;
+  if (p && p->numThreads>1 && numItems>1)
+    {
+      // The items go to the tail of the queue of this thread, so that
+      // it works on them first, while the others may steal them.
+      int w=currentThread;
+      int pending=numItems;
+      Entry e;
+      e.task=&task;
+      e.pending=&pending;
+      for (int n=numItems-1; n>=0; n--)
+	{
+	  e.item=n;
+	  p->push (w, e);
+	}
+      p->wake ();
+
+      // Help until all items are done, and sleep while the stolen
+      // ones are run.  The time spent waiting doesn't count as busy.
+      Worker& me=p->workers[w];
+      for (;;)
+	{
+	  if (!p->take (w, e))
+	    {
+	      double start=GPTime ();
+	      int found=p->waitForWork (w, &pending, e);
+	      me.nested+=GPTime ()-start;
+	      if (!found)
+		break;
+	    }
+	  p->execute (w, e);
+	}
+      return;
+    }
+#endif
+
+  for (int n=0; n<numItems; n++)
+    task.run (n);
+}
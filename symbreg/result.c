@@ -0,0 +1,80 @@
+/* symbreg: generated by gpc++ from the GP
+
+GP: x*x+x+ADF0 (x,x)+x*x*x
+ADF0: x2*x1*x2*x1
+*/
+
+#include <math.h>
+static inline double limit (double v)
+{
+  if (v>1e6) return 1e6;
+  if (v<-1e6) return -1e6;
+  return v;
+}
+static inline double divide (double x, double y)
+{
+  if (fabs (y)<1e-6) return x*y<0.0 ? -1e6 : 1e6;
+  return x/y;
+}
+
+static double symbreg_0 (void*);
+static double symbreg_1 (double, double, void*);
+static double symbreg_0 (void* context)
+{
+  return limit ((limit ((limit ((limit ((limit (*(double*) context))*(limit (*(double*) context))))+(limit (*(double*) context))))+(symbreg_1 (limit (*(double*) context), limit (*(double*) context), context))))+(limit ((limit ((limit (*(double*) context))*(limit (*(double*) context))))*(limit (*(double*) context)))));
+}
+static double symbreg_1 (double a0, double a1, void* context)
+{
+  return limit ((limit ((a1)*(a0)))*(limit ((a1)*(a0))));
+}
+double symbreg (double* args, void* context)
+{
+  return symbreg_0 (context);
+}
+
+#ifdef GPEXPORTTEST
+#include <stdio.h>
+#include <math.h>
+
+static double symbreg_sample[10][1]={
+  { 0 },
+  { 1 },
+  { 2 },
+  { 3 },
+  { 4 },
+  { 5 },
+  { 6 },
+  { 7 },
+  { 8 },
+  { 9 },
+};
+static double symbreg_expected[10]={
+  0,
+  4,
+  30,
+  120,
+  340,
+  780,
+  1554,
+  2800,
+  4680,
+  7380,
+};
+
+int main (void)
+{
+  int n, errors=0;
+  for (n=0; n<10; n++)
+    {
+      double e=symbreg_expected[n];
+      double r=symbreg (0, symbreg_sample[n]);
+      if (fabs (r-e)>1e-9*(1.0+fabs (e)))
+        {
+          printf ("Sample %d: %.17g instead of %.17g\n", n, r, e);
+          errors++;
+        }
+    }
+  printf ("symbreg: %d of %d samples wrong\n", errors, 10);
+  return errors!=0;
+}
+#endif
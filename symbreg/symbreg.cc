@@ -55,9 +55,23 @@ using namespace std;
 // question and answer array with some points for the function
 #define EQUATION(x)  (x*x*x*x + x*x*x + x*x + x)
 #define DATAPOINTS 10
+// The number of data points calculated at once by the block
+// evaluation, the same as the kernel's (see GP::runCases())
+#define BLOCKSIZE GPCaseBlockSize
 double ques[DATAPOINTS];
 double answ[DATAPOINTS];
 
+// The same points in single precision (configuration parameter
+// SinglePrecision)
+float quesFloat[DATAPOINTS];
+float answFloat[DATAPOINTS];
+
+// The function and terminal sets
+GPAdfNodeSet adfNs;
+
+// The native code of the GPs (configuration parameter Interpreter=2)
+GPNativeCompiler* native=NULL;
+
 // The TeX-file
 ofstream tout;
 int printTexStyle=0;
@@ -67,6 +81,9 @@ int printTexStyle=0;
 // just add them below and insert an entry in the configArray.
 GPVariables cfg;
 char *InfoFileName="data";
+int Interpreter=0;
+int SinglePrecision=0;
+int RescoreBest=0;
 struct GPConfigVarInformation configArray[]=
 {
   {"PopulationSize", DATAINT, &cfg.PopulationSize},
@@ -84,8 +101,18 @@ struct GPConfigVarInformation configArray[]=
   {"SwapMutationProbability", DATADOUBLE, &cfg.SwapMutationProbability},
   {"ShrinkMutationProbability", DATADOUBLE, &cfg.ShrinkMutationProbability},
   {"SteadyState", DATAINT, &cfg.SteadyState},
+  {"ArenaAllocation", DATAINT, &cfg.ArenaAllocation},
+  {"HashConsing", DATAINT, &cfg.HashConsing},
+  {"Recycling", DATAINT, &cfg.Recycling},
+  {"OutOfCore", DATAINT, &cfg.OutOfCore},
+  {"FitnessMemo", DATAINT, &cfg.FitnessMemo},
+  {"ResultCacheSize", DATAINT, &cfg.ResultCacheSize},
+  {"EvaluationThreads", DATAINT, &cfg.EvaluationThreads},
   {"AddBestToNewPopulation", DATAINT, &cfg.AddBestToNewPopulation},
   {"InfoFileName", DATASTRING, &InfoFileName},
+  {"Interpreter", DATAINT, &Interpreter},
+  {"SinglePrecision", DATAINT, &SinglePrecision},
+  {"RescoreBest", DATAINT, &RescoreBest},
   {"", DATAINT, NULL}
 };
 
@@ -128,32 +155,32 @@ void MyGene::printMathStyle (ostream& os, int lastPrecedence)
       switch (node->value ())
 	{
 	case '*': 
-	  NthMyChild(0)->printMathStyle (os, precedence);
+	  NthChild(0)->printMathStyle (os, precedence);
 	  os << "*";
-	  NthMyChild(1)->printMathStyle (os, precedence);
+	  NthChild(1)->printMathStyle (os, precedence);
 	  break;
 	case '+': 
-	  NthMyChild(0)->printMathStyle (os, precedence);
+	  NthChild(0)->printMathStyle (os, precedence);
 	  os << "+";
-	  NthMyChild(1)->printMathStyle (os, precedence);
+	  NthChild(1)->printMathStyle (os, precedence);
 	  break;
 	case '-': 
-	  NthMyChild(0)->printMathStyle (os, precedence);
+	  NthChild(0)->printMathStyle (os, precedence);
 	  os << "-";
-	  NthMyChild(1)->printMathStyle (os, precedence);
+	  NthChild(1)->printMathStyle (os, precedence);
 	  break;
 	case '%': 
-	  NthMyChild(0)->printMathStyle (os, precedence);
+	  NthChild(0)->printMathStyle (os, precedence);
 	  os << "%";
-	  NthMyChild(1)->printMathStyle (os, precedence);
+	  NthChild(1)->printMathStyle (os, precedence);
 	  break;
 	case 'A': 
 	  // This is the ADF0-function. We put the parameters in
 	  // brackets and start again with precedence 0.
 	  os << "ADF0 (";
-	  NthMyChild(0)->printMathStyle (os, 0);
+	  NthChild(0)->printMathStyle (os, 0);
 	  os << ",";
-	  NthMyChild(1)->printMathStyle (os, 0);
+	  NthChild(1)->printMathStyle (os, 0);
 	  os << ")";
 	  break;
 	default: 
@@ -210,35 +237,35 @@ void MyGene::printTeXStyle (ostream& os, int lastPrecedence)
       switch (node->value())
 	{
 	case '*': 
-	  NthMyChild(0)->printTeXStyle (os, precedence);
+	  NthChild(0)->printTeXStyle (os, precedence);
 	  os << " ";
-	  NthMyChild(1)->printTeXStyle (os, precedence);
+	  NthChild(1)->printTeXStyle (os, precedence);
 	  break;
 	case '+': 
-	  NthMyChild(0)->printTeXStyle (os, precedence);
+	  NthChild(0)->printTeXStyle (os, precedence);
 	  os << "+";
-	  NthMyChild(1)->printTeXStyle (os, precedence);
+	  NthChild(1)->printTeXStyle (os, precedence);
 	  break;
 	case '-': 
-	  NthMyChild(0)->printTeXStyle (os, precedence);
+	  NthChild(0)->printTeXStyle (os, precedence);
 	  os << "-";
-	  NthMyChild(1)->printTeXStyle (os, precedence);
+	  NthChild(1)->printTeXStyle (os, precedence);
 	  break;
 	case '%': 
 	  // As we use \frac, we start again with precedence 0
 	  os << "\\frac{";
-	  NthMyChild(0)->printTeXStyle (os, 0);
+	  NthChild(0)->printTeXStyle (os, 0);
 	  os << "}{";
-	  NthMyChild(1)->printTeXStyle (os, 0);
+	  NthChild(1)->printTeXStyle (os, 0);
 	  os << "}";
 	  break;
 	case 'A': 
 	  // This is the ADF0-function. We put the parameters in
 	  // brackets and start again with precedence 0.
 	  os << "f_2(";
-	  NthMyChild(0)->printTeXStyle (os, 0);
+	  NthChild(0)->printTeXStyle (os, 0);
 	  os << ",";
-	  NthMyChild(1)->printTeXStyle (os, 0);
+	  NthChild(1)->printTeXStyle (os, 0);
 	  os << ")";
 	  break;
 	default: 
@@ -349,31 +376,31 @@ double MyGene::evaluate (double x, MyGP& gp, double arg0, double arg1)
     switch (node->value ())
       {
       case '*': 
-	ret=NthMyChild(0)->evaluate (x, gp, arg0, arg1)
-	  * NthMyChild(1)->evaluate (x, gp, arg0, arg1);
+	ret=NthChild(0)->evaluate (x, gp, arg0, arg1)
+	  * NthChild(1)->evaluate (x, gp, arg0, arg1);
 	break;
       case '+': 
-	ret=NthMyChild(0)->evaluate (x, gp, arg0, arg1)
-	  + NthMyChild(1)->evaluate (x, gp, arg0, arg1);
+	ret=NthChild(0)->evaluate (x, gp, arg0, arg1)
+	  + NthChild(1)->evaluate (x, gp, arg0, arg1);
 	break;
       case '-': 
-	ret=NthMyChild(0)->evaluate (x, gp, arg0, arg1)
-	  - NthMyChild(1)->evaluate (x, gp, arg0, arg1);
+	ret=NthChild(0)->evaluate (x, gp, arg0, arg1)
+	  - NthChild(1)->evaluate (x, gp, arg0, arg1);
 	break;
       case '%': 
 	// We use the function divide rather than "/" to ensure the
 	// closure property
-	ret=divide (NthMyChild(0)->evaluate (x, gp, arg0, arg1), 
-		    NthMyChild(1)->evaluate (x, gp, arg0, arg1));
+	ret=divide (NthChild(0)->evaluate (x, gp, arg0, arg1), 
+		    NthChild(1)->evaluate (x, gp, arg0, arg1));
 	break;
       case 'A': 
 	// This is the ADF0 function call.  We have access to that
 	// subtree, as the GP gave us a reference to itself as
 	// parameter.  We first evaluate the subtrees, and then call
 	// the adf with the parameters
-	a0=NthMyChild(0)->evaluate (x, gp, arg0, arg1);
-	a1=NthMyChild(1)->evaluate (x, gp, arg0, arg1);
-	ret=gp.NthMyGene(1)->evaluate (x, gp, a0, a1);
+	a0=NthChild(0)->evaluate (x, gp, arg0, arg1);
+	a1=NthChild(1)->evaluate (x, gp, arg0, arg1);
+	ret=gp.NthGene(1)->evaluate (x, gp, a0, a1);
 	break;
       default: 
 	GPExitSystem ("MyGene::evaluate", "Undefined function value");
@@ -407,27 +434,321 @@ double MyGene::evaluate (double x, MyGP& gp, double arg0, double arg1)
 
 
 
+// Restricts the values of a block the same way as MyGene::evaluate()
+template <class T>
+inline void limitBlock (T* v, int n)
+{
+  const T maxValue=(T) 1e6;
+  for (int i=0; i<n; i++)
+    v[i]=v[i]>maxValue ? maxValue : (v[i]<-maxValue ? -maxValue : v[i]);
+}
+
+
+
+// The same as MyGene::evaluate(), but for a block of n data points
+// at once (configuration parameter Interpreter=3): The tree is walked
+// only once, and every node is calculated for all the points in a
+// simple loop the compiler can vectorise.  x, arg0 and arg1 hold the
+// values of the terminals for the points, and the results are written
+// to ret.  n must not be larger than BLOCKSIZE.  T is double, or
+// float for the evaluation in single precision.
+template <class T>
+void MyGene::evaluateBlock (const T* x, int n, MyGP& gp, 
+			    const T* arg0, const T* arg1, T* ret)
+{
+  // The second argument of the functions is calculated into this
+  // buffer, the first directly into the result
+  T a[BLOCKSIZE];
+
+  if (isFunction ())
+    {
+      NthChild(0)->evaluateBlock (x, n, gp, arg0, arg1, ret);
+      NthChild(1)->evaluateBlock (x, n, gp, arg0, arg1, a);
+      functionBlock (x, n, gp, ret, a);
+    }
+  if (isTerminal ())
+    {
+      const T* values=NULL;
+      switch (node->value ())
+	{
+	case 'X': 
+	  values=x;
+	  break;
+	case 1:
+	  values=arg0;
+	  break;
+	case 2:
+	  values=arg1;
+	  break;
+	default: 
+	  GPExitSystem ("MyGene::evaluateBlock", 
+			"Undefined terminal value");
+	}
+      memcpy (ret, values, n*sizeof (T));
+      limitBlock (ret, n);
+    }
+}
+
+
+
+// Calculates the function of the gene for a block of data points:
+// The values of the arguments are in ret and a, and the restricted
+// results are written to ret.
+template <class T>
+void MyGene::functionBlock (const T* x, int n, MyGP& gp, T* ret, T* a)
+{
+  T a0[BLOCKSIZE];
+  const T maxValue=(T) 1e6, minDenominator=(T) 1e-6;
+  int i;
+
+  switch (node->value ())
+    {
+    case '*': 
+      for (i=0; i<n; i++)
+	ret[i]*=a[i];
+      break;
+    case '+': 
+      for (i=0; i<n; i++)
+	ret[i]+=a[i];
+      break;
+    case '-': 
+      for (i=0; i<n; i++)
+	ret[i]-=a[i];
+      break;
+    case '%': 
+      // The same as divide(), but without branches.  The quotient is
+      // calculated even for a small denominator and then replaced.
+      for (i=0; i<n; i++)
+	{
+	  T q=ret[i]/a[i];
+	  T large=ret[i]*a[i]<0 ? -maxValue : maxValue;
+	  ret[i]=fabs (a[i])<minDenominator ? large : q;
+	}
+      break;
+    case 'A': 
+      // The ADF writes its result to ret while reading its arguments,
+      // so the first one is copied
+      memcpy (a0, ret, n*sizeof (T));
+      gp.NthGene(1)->evaluateBlock (x, n, gp, (const T*) a0, 
+				    (const T*) a, ret);
+      break;
+    default: 
+      GPExitSystem ("MyGene::functionBlock", "Undefined function value");
+    }
+
+  limitBlock (ret, n);
+}
+
+
+
+// The block evaluation of the main tree with the result cache that
+// the population selected (configuration parameter ResultCacheSize).
+// key points to the key of this gene (see
+// GPResultCache::subtreeKeys()) and is moved behind the keys of its
+// subtree.  The results of the functions are cached
+// for each block of data points, which is identified by the index of
+// its first point.  Terminals are not worth it.
+void MyGene::evaluateBlockCached (const double* x, int n, int block, 
+				  MyGP& gp, GPResultKey*& key, 
+				  double* ret)
+{
+  GPResultCache* cache=GPResultCache::selected ();
+  GPResultKey& k=*key++;
+  int cacheable=isFunction () && !k.flags;
+  if (cacheable)
+    {
+      double* v=cache->find (k.hash+block, k.check);
+      if (v)
+	{
+	  memcpy (ret, v, n*sizeof (double));
+	  key+=k.length-1;
+	  return;
+	}
+    }
+
+  if (isFunction ())
+    {
+      double a[BLOCKSIZE];
+      NthChild(0)->evaluateBlockCached (x, n, block, gp, key, ret);
+      NthChild(1)->evaluateBlockCached (x, n, block, gp, key, a);
+      functionBlock (x, n, gp, ret, a);
+    }
+  else
+    evaluateBlock (x, n, gp, (const double*) NULL, (const double*) NULL,
+		   ret);
+
+  if (cacheable)
+    memcpy (cache->insert (k.hash+block, k.check), ret, 
+	    n*sizeof (double));
+}
+
+
+
+// The primitives for the compiled evaluation (configuration
+// parameter Interpreter=1).  They do the same as MyGene::evaluate().
+// The context is the current x value.
+inline double limitValue (double v)
+{
+  const double maxValue=1e6;
+  if (v>maxValue)
+    return maxValue;
+  if (v<-maxValue)
+    return -maxValue;
+  return v;
+}
+
+static double primAdd (double* a, void*) { return limitValue (a[0]+a[1]); }
+static double primSub (double* a, void*) { return limitValue (a[0]-a[1]); }
+static double primMul (double* a, void*) { return limitValue (a[0]*a[1]); }
+static double primDiv (double* a, void*) { 
+  return limitValue (divide (a[0], a[1])); }
+static double primX (double*, void* x) { return limitValue (*(double*) x); }
+
+
+
+// The functions for the sources of the nodes of the native code
+// (configuration parameter Interpreter=2) and the exported C
+// function.  They are the same as divide() and limitValue().
+char* nativePrelude=
+  "#include <math.h>\n"
+  "static inline double limit (double v)\n"
+  "{\n"
+  "  if (v>1e6) return 1e6;\n"
+  "  if (v<-1e6) return -1e6;\n"
+  "  return v;\n"
+  "}\n"
+  "static inline double divide (double x, double y)\n"
+  "{\n"
+  "  if (fabs (y)<1e-6) return x*y<0.0 ? -1e6 : 1e6;\n"
+  "  return x/y;\n"
+  "}\n";
+
+
+
+// All GPs of the population that are not evaluated yet are compiled
+// to native code at once before they are evaluated.  GPs whose
+// fitness is known from the fitness table (configuration parameter
+// FitnessMemo) are left out.  The functions are looked up here, as
+// the compiler may not be used by several threads at once
+// (configuration parameter EvaluationThreads).
+void MyPopulation::evaluateMembers (int startIx, int endIx)
+{
+  if (native)
+    {
+      recallFitness (startIx, endIx);
+      for (int n=startIx; n<endIx; n++)
+	if (!NthGP (n)->isFitnessValid ())
+	  native->add (*NthGP (n));
+      native->build ();
+      for (int n=startIx; n<endIx; n++)
+	if (!NthGP (n)->isFitnessValid ())
+	  NthGP (n)->nativeFunction=native->function (*NthGP (n));
+    }
+  GPPopulation::evaluateMembers (startIx, endIx);
+}
+
+
+
+// The sum of the square errors of a GP at the data points q with the
+// answers a, calculated by the block evaluation with values of type
+// T.  The sum itself is always calculated in double precision.
+template <class T>
+double blockError (MyGP& gp, const T* q, const T* a)
+{
+  double error=0.0;
+  T result[BLOCKSIZE];
+  for (int i=0; i<DATAPOINTS; i+=BLOCKSIZE)
+    {
+      int n=DATAPOINTS-i<BLOCKSIZE ? DATAPOINTS-i : BLOCKSIZE;
+      gp.NthGene(0)->evaluateBlock (&q[i], n, gp, (const T*) NULL, 
+				    (const T*) NULL, result);
+      for (int j=0; j<n; j++)
+	error+=pow (a[i+j]-result[j], 2);
+    }
+  return error;
+}
+
+
+
+// The same as blockError() in double precision, with the result
+// cache
+double cachedBlockError (MyGP& gp)
+{
+  double error=0.0, result[BLOCKSIZE];
+  GPResultKey* keys=new GPResultKey[gp.length ()];
+  GPResultCache::subtreeKeys (gp, adfNs, keys);
+  for (int i=0; i<DATAPOINTS; i+=BLOCKSIZE)
+    {
+      int n=DATAPOINTS-i<BLOCKSIZE ? DATAPOINTS-i : BLOCKSIZE;
+      GPResultKey* key=keys;
+      gp.NthGene(0)->evaluateBlockCached (&ques[i], n, i, gp, key, 
+					  result);
+      for (int j=0; j<n; j++)
+	error+=pow (answ[i+j]-result[j], 2);
+    }
+  delete [] keys;
+  return error;
+}
+
+
+
 // Evaluate the fitness of a GP and save it into the GP class variable
 // stdFitness.
 void MyGP::evaluate ()
+{
+  calculateFitness (SinglePrecision);
+}
+
+
+
+// Calculate the fitness of a GP, either in single precision by the
+// block evaluation, or in double precision as set by the
+// configuration parameter Interpreter.
+void MyGP::calculateFitness (int singlePrecision)
 {
   double rawfitness=0.0, diff=0.0;
 
+  // The native code, if there is one for this GP (in steady state
+  // mode, GPs are evaluated one by one and not compiled)
+  GPPrimitive function=!singlePrecision ? nativeFunction : NULL;
+
   // The evaluation function checks with some values of the
-  // mathematical function
-  for (int i=0; i<DATAPOINTS; i++)
+  // mathematical function.  The block evaluation calculates the
+  // results of the GP for up to BLOCKSIZE values at once.
+  if (singlePrecision)
+    rawfitness=blockError (*this, quesFloat, answFloat);
+  else if (!function && Interpreter==3 && GPResultCache::selected ())
+    rawfitness=cachedBlockError (*this);
+  else if (!function && Interpreter==3)
+    rawfitness=blockError (*this, ques, answ);
+  else if (!function && Interpreter==1)
     {
-      // Calculate genetic programs answer.  ques[i] is the current x
-      // value of the function.
-      double result=NthMyGene(0)->evaluate (ques[i], *this, 0, 0);
-
-      // Calculate square error between the genetic program and the
-      // actual answer.
-      diff=pow (answ[i]-result, 2);
-
-      // Add this difference to total rawfitness
-      rawfitness+=diff;
+      // The kernel runs the GP for all data points at once, with the
+      // result cache of the population
+      double result[DATAPOINTS];
+      runCases (adfNs, DATAPOINTS, (char*) ques, sizeof (double), result);
+      for (int i=0; i<DATAPOINTS; i++)
+	rawfitness+=pow (answ[i]-result[i], 2);
     }
+  else
+    for (int i=0; i<DATAPOINTS; i++)
+      {
+	// Calculate genetic programs answer.  ques[i] is the current x
+	// value of the function.  The GP is either evaluated gene by
+	// gene, or its native code is called.
+	double result;
+	if (function)
+	  result=function (NULL, &ques[i]);
+	else
+	  result=NthGene(0)->evaluate (ques[i], *this, 0, 0);
+
+	// Calculate square error between the genetic program and the
+	// actual answer.
+	diff=pow (answ[i]-result, 2);
+
+	// Add this difference to total rawfitness
+	rawfitness+=diff;
+      }
   rawfitness=sqrt (rawfitness);
 
   // We want a short solution and put the total GP length to the
@@ -439,6 +760,56 @@ void MyGP::evaluate ()
 
 
 
+// Evaluate the best GPs again in double precision before the best of
+// the population is searched for, if the search uses single precision
+// (configuration parameters SinglePrecision and RescoreBest).  The
+// members of an out-of-core population are not in memory here and are
+// left alone.
+void MyPopulation::calculateStatistics ()
+{
+  if (SinglePrecision && RescoreBest>0 && !store)
+    {
+      char* rescored=new char[containerSize ()];
+      memset (rescored, 0, containerSize ());
+      for (int k=0; k<RescoreBest && k<containerSize (); k++)
+	{
+	  int best=-1;
+	  for (int n=0; n<containerSize (); n++)
+	    if (!rescored[n] && (best==-1 || NthGP (n)->getFitness () 
+				 < NthGP (best)->getFitness ()))
+	      best=n;
+	  rescored[best]=1;
+	}
+      for (int n=0; n<containerSize (); n++)
+	if (rescored[n])
+	  NthGP (n)->calculateFitness (0);
+      delete [] rescored;
+    }
+
+  GPPopulation::calculateStatistics ();
+}
+
+
+
+// The report of a generation tells how well the result cache did
+// since the last one
+void MyPopulation::createGenerationReport (int printLegend, 
+					  int generation, ostream& fout, 
+					  ostream& bout)
+{
+  GPPopulation::createGenerationReport (printLegend, generation, 
+					fout, bout);
+  if (resultCache && (Interpreter==1 || Interpreter==3))
+    {
+      resultCache->printStatistics (fout);
+      resultCache->printStatistics (cout);
+      fout << endl;
+      resultCache->resetStatistics ();
+    }
+}
+
+
+
 // Create function and terminal set
 void createNodeSet (GPAdfNodeSet& adfNs)
 {
@@ -466,6 +837,34 @@ void createNodeSet (GPAdfNodeSet& adfNs)
   ns1.putNode (*new GPNode ('*', "*", 2));
   ns1.putNode (*new GPNode (1, "x1"));
   ns1.putNode (*new GPNode (2, "x2"));
+
+  // The primitives for the compiled evaluation
+  ns0.setPrimitive ('+', primAdd);
+  ns0.setPrimitive ('-', primSub);
+  ns0.setPrimitive ('*', primMul);
+  ns0.setPrimitive ('%', primDiv);
+  ns0.setAdfCall ('A', 1);
+  ns0.setPrimitive ('X', primX);
+  ns1.setPrimitive ('+', primAdd);
+  ns1.setPrimitive ('*', primMul);
+  ns1.setArgument (1, 0);
+  ns1.setArgument (2, 1);
+
+  // The primitives have no side effects, so the kernel may evaluate
+  // the GPs for many data points at once and keep the results of
+  // subtrees
+  ns0.setPure ();
+  ns1.setPure ();
+
+  // The sources for the native code.  ADF calls and arguments are
+  // taken from the primitives above.
+  ns0.setSource ('+', "limit (%1+%2)");
+  ns0.setSource ('-', "limit (%1-%2)");
+  ns0.setSource ('*', "limit (%1*%2)");
+  ns0.setSource ('%', "limit (divide (%1, %2))");
+  ns0.setSource ('X', "limit (*(double*) context)");
+  ns1.setSource ('+', "limit (%1+%2)");
+  ns1.setSource ('*', "limit (%1*%2)");
 }
 
 
@@ -490,6 +889,8 @@ int main ()
     {
       ques[i]=i;
       answ[i]=EQUATION(ques[i]);
+      quesFloat[i]=(float) ques[i];
+      answFloat[i]=(float) answ[i];
     }
 
   // Init GP system.
@@ -517,16 +918,30 @@ int main ()
        << "\\documentstyle[a4]{article}" << endl
        << "\\begin{document}" << endl;
   
-  // Print the configuration to the files just opened
+  // Print the configuration to the files just opened, with the
+  // precision of the evaluation
   fout << cfg << endl;
   cout << cfg << endl;
+  if (SinglePrecision)
+    {
+      fout << "Evaluation in single precision";
+      cout << "Evaluation in single precision";
+      if (RescoreBest>0)
+	{
+	  fout << ", the best " << RescoreBest << " GPs again in double";
+	  cout << ", the best " << RescoreBest << " GPs again in double";
+	}
+      fout << endl << endl;
+      cout << endl << endl;
+    }
   tout << "\\begin{verbatim}\n" << cfg << "\\end{verbatim}\n" << endl;
   
   // Create the adf function/terminal set and print it out.
-  GPAdfNodeSet adfNs;
   createNodeSet (adfNs);
   cout << adfNs << endl; 
   fout << adfNs << endl;  
+  if (Interpreter==2)
+    native=new GPNativeCompiler (adfNs, nativePrelude);
 
   // Create a population with this configuration
   cout << "Creating initial population ..." << endl;
@@ -548,15 +963,27 @@ int main ()
     {
       // Create a new generation from the old one by applying the
       // genetic operators
-      if (!cfg.SteadyState)
+      if (!cfg.SteadyState && !newPop)
 	newPop=new MyPopulation (cfg, adfNs);
       pop->generate (*newPop);
       
-      // Delete the old generation and make the new the old one
+      // Delete the old generation and make the new the old one.  If
+      // Recycling is set, the old generation is only emptied and
+      // becomes the new population of the next generation.
       if (!cfg.SteadyState)
 	{
-	  delete pop;
+	  MyPopulation* oldPop=pop;
 	  pop=newPop;
+	  if (cfg.Recycling)
+	    {
+	      newPop=oldPop;
+	      newPop->clear ();
+	    }
+	  else
+	    {
+	      delete oldPop;
+	      newPop=NULL;
+	    }
 	}
 
       // Print the best of generation to the LaTeX-file.
@@ -577,10 +1004,25 @@ int main ()
        << endl;
   tout.close ();
 
+  // Export the best of the last generation as C function, with a
+  // test program that compares it with the tree at the data points
+  MyGP& best=*pop->NthGP (pop->bestOfPopulation);
+  double expected[DATAPOINTS];
+  for (int i=0; i<DATAPOINTS; i++)
+    expected[i]=best.NthGene (0)->evaluate (ques[i], best, 0, 0);
+  ostrstream strCFile;
+  strCFile << InfoFileName << ".c" << ends;
+  ofstream cfile (strCFile.str());
+  GPNativeCompiler exporter (adfNs, nativePrelude);
+  exporter.exportFunction (cfile, best, "symbreg", DATAPOINTS, 1, 
+			   ques, expected);
+  cfile.close ();
+
   cout << "\nResults are in " 
        << InfoFileName << ".dat," 
        << InfoFileName << ".tex,"
-       << InfoFileName << ".stc." << endl;
+       << InfoFileName << ".stc,"
+       << InfoFileName << ".c." << endl;
 
   return 0;
 }
@@ -35,68 +35,77 @@ WWW:    http://www.emk.e-technik.th-darmstadt/~thomasw
 --------------------------------------------------------------- */
 
 // We are now inheriting the classes we want to change. These are the
-// three classes GPGene, GP and GPPopulation.  Read the documentation
-// for what has to be done here.  Remember it makes not a lot of sense
-// to implement Load/Save here, otherwise we should definitely have to
-// provide for the isA(), load(), save() and createObject() functions.
+// three classes GPGene, GP and GPPopulation.  We use the templates
+// GPGeneT, GPT and GPPopulationT, which provide the functions
+// duplicate(), createChild(), createGene() and createGP() for us.
+// Read the documentation for what has to be done here.  Remember it
+// makes not a lot of sense to implement Load/Save here, otherwise we
+// should definitely have to provide for the isA(), load(), save() and
+// createObject() functions.
 
 class MyGP;
 
-class MyGene : public GPGene
+class MyGene : public GPGeneT<MyGene>
 {
 public:
-  MyGene (GPNode& gpo) : GPGene (gpo) {}
-
-  MyGene (const MyGene& gpo) : GPGene (gpo) { }
-  virtual GPObject& duplicate () { return *(new MyGene(*this)); }
-  virtual GPGene* createChild (GPNode& gpo) {
-    return new MyGene (gpo); }
+  MyGene (GPNode& gpo) : GPGeneT<MyGene> (gpo) {}
+  MyGene (const MyGene& gpo) : GPGeneT<MyGene> (gpo) { }
 
   virtual void printOn (ostream& os);
   void printMathStyle (ostream& os, int lastPrecedence=0);
   void printTeXStyle (ostream& os, int lastPrecedence=0);
 
-  MyGene* NthMyChild (int n) {
-    return (MyGene*) GPContainer::Nth (n); }
-
   double evaluate (double x, MyGP& gp, double arg0, double arg1);
+  template <class T>
+  void evaluateBlock (const T* x, int n, MyGP& gp, 
+		      const T* arg0, const T* arg1, T* ret);
+  template <class T>
+  void functionBlock (const T* x, int n, MyGP& gp, T* ret, T* a);
+  void evaluateBlockCached (const double* x, int n, int block, 
+			    MyGP& gp, GPResultKey*& key, double* ret);
 };
 
 
 
-class MyGP : public GP 
+class MyGP : public GPT<MyGP, MyGene>
 {
 public:
-  MyGP (int genes) : GP (genes) {}
-
-  MyGP (MyGP& gpo) : GP (gpo) { }
-  virtual GPObject& duplicate () { return *(new MyGP(*this)); }
-  virtual GPGene* createGene (GPNode& gpo) {
-    return new MyGene (gpo); }
+  MyGP (int genes) : GPT<MyGP, MyGene> (genes) { nativeFunction=NULL; }
+  MyGP (MyGP& gpo) : GPT<MyGP, MyGene> (gpo) { nativeFunction=NULL; }
 
   virtual void printOn (ostream& os);
 
-  MyGene* NthMyGene (int n) {
-    return (MyGene*) GPContainer::Nth (n); }
   virtual void evaluate ();
+  void calculateFitness (int singlePrecision);
+
+  // The native code of the GP, looked up before the population is
+  // evaluated (NULL if there is none)
+  GPPrimitive nativeFunction;
 };
 
 
 
-class MyPopulation : public GPPopulation
+class MyPopulation : public GPPopulationT<MyPopulation, MyGP>
 {
 public:
   MyPopulation (GPVariables& GPVar_, GPAdfNodeSet& adfNs_) : 
-    GPPopulation (GPVar_, adfNs_) {}
-
-  MyPopulation (MyPopulation& gpo) : GPPopulation(gpo) {}
-  virtual GPObject& duplicate () { return *(new MyPopulation(*this)); }
+    GPPopulationT<MyPopulation, MyGP> (GPVar_, adfNs_) {}
+  MyPopulation (MyPopulation& gpo) : 
+    GPPopulationT<MyPopulation, MyGP> (gpo) {}
 
   // Don't check for ultimate diversity as it takes a long time.
   // Accept every created GP
   virtual int checkForValidCreation (GP&) { return 1; }
 
-  virtual GP* createGP (int numOfGenes) { return new MyGP (numOfGenes); }
+  // Compile the GPs to native code before they are evaluated
+  virtual void evaluateMembers (int startIx, int endIx);
+
+  // Evaluate the best GPs again in double precision
+  virtual void calculateStatistics ();
+
+  // Print the statistics of the result cache
+  virtual void createGenerationReport (int printLegend, int generation,
+				       ostream& fout, ostream& bout);
 };
 
 